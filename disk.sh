@@ -2,8 +2,8 @@
 set -e
 
 # 1. 先创建一个基础镜像 ext2_hda.img
-dd if=/dev/zero of=ext2_hda.img bs=1M count=100          # 100 MiB 空盘
-mkfs.ext2 ext2_hda.img                                  # 在整个文件上格式化 ext2
+dd if=/dev/zero of=ext2_hda.img bs=1M count=132          # 132 MiB 空盘
+mkfs.ext2 ext2_hda.img 100M                             # 前 100 MiB 格式化 ext2，后 32 MiB 留作交换区
 
 # 2. 复制出更多硬盘
 # for letter in b c d; do
@@ -10,8 +10,8 @@ HELLO=./user/hello
 make -C user
 
 # 1. 先创建一个基础镜像
-dd if=/dev/zero of="$IMG" bs=1M count=100        # 100 MiB 空盘
-mkfs.ext2 -F "$IMG"                              # 在整个文件上格式化 ext2（-F 允许格式化文件）
+dd if=/dev/zero of="$IMG" bs=1M count=132        # 132 MiB 空盘
+mkfs.ext2 -F "$IMG" 100M                         # 前 100 MiB 格式化 ext2（-F 允许格式化文件），后 32 MiB 是交换区
 
 # 2. 挂载镜像并创建测试文件
 sudo mkdir -p "$MNT"
@@ -11,6 +11,11 @@ static const size_t VGA_WIDTH = 80;
 static const size_t VGA_HEIGHT = 25;
 static uint16_t* const VGA_MEMORY = (uint16_t*) 0xC03FF000;
 
+// A copy of the screen in ordinary (write-back) RAM. VRAM is mapped
+// write-combining, so reading it back is slow: scrolling shifts this copy
+// and only ever writes VRAM.
+static uint16_t terminal_shadow[80 * 25];
+
 static size_t terminal_row;
 static size_t terminal_column;
 static uint8_t terminal_color;
@@ -24,11 +29,16 @@ void terminal_initialize(void) {
     terminal_clear();
 }
 
+uintptr_t terminal_vram(void) {
+    return (uintptr_t)VGA_MEMORY;
+}
+
 void terminal_clear(void) {
     for (size_t y = 0; y < VGA_HEIGHT; y++) {
         for (size_t x = 0; x < VGA_WIDTH; x++) {
             const size_t index = y * VGA_WIDTH + x;
-            terminal_buffer[index] = vga_entry(' ', terminal_color);
+            terminal_shadow[index] = vga_entry(' ', terminal_color);
+            terminal_buffer[index] = terminal_shadow[index];
         }
     }
     terminal_row = 0;
@@ -41,21 +51,21 @@ void terminal_setcolor(uint8_t color) {
 
 void terminal_putentryat(unsigned char c, uint8_t color, size_t x, size_t y) {
     const size_t index = y * VGA_WIDTH + x;
-    terminal_buffer[index] = vga_entry(c, color);
+    terminal_shadow[index] = vga_entry(c, color);
+    terminal_buffer[index] = terminal_shadow[index];
 }
 
 // Scrolls the terminal up by one line, and clears the last line.
 static void terminal_scroll(void) {
-    // Move each line up one row
-    for (size_t y = 1; y < VGA_HEIGHT; y++) {
-        kmemcpy(&terminal_buffer[(y - 1) * VGA_WIDTH],
-               &terminal_buffer[y * VGA_WIDTH],
-               VGA_WIDTH * sizeof(uint16_t));
-    }
+    // Move each line up one row in the shadow copy
+    kmemmove(terminal_shadow, &terminal_shadow[VGA_WIDTH],
+             (VGA_HEIGHT - 1) * VGA_WIDTH * sizeof(uint16_t));
     // Clear the last row
     for (size_t x = 0; x < VGA_WIDTH; x++) {
-        terminal_putentryat(' ', terminal_color, x, VGA_HEIGHT - 1);
+        terminal_shadow[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = vga_entry(' ', terminal_color);
     }
+    // Write the whole screen out; VRAM is never read
+    kmemcpy(terminal_buffer, terminal_shadow, sizeof(terminal_shadow));
     // Adjust the row counter to the last row.
     terminal_row = VGA_HEIGHT - 1;
 }
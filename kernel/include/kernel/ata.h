@@ -14,6 +14,9 @@ uint32_t ata_read_sectors(uint32_t lba, uint8_t count, uint8_t *buffer);
 
 uint32_t ata_write_sectors(uint32_t lba, uint8_t count, const uint8_t *buffer);
 
+// IDENTIFY 报告的扇区总数
+uint32_t ata_get_total_blocks(void);
+
 void ata_rw_selftest(void);
 
 void block_devices_init(void);
@@ -0,0 +1,38 @@
+#ifndef _AVL_H
+#define _AVL_H
+
+#include <stddef.h>
+
+/*
+ * 侵入式 AVL 树：节点嵌在调用者自己的结构体里，用 container_of 取回来。
+ * 查找由调用者自己从 root 往下走（比较规则各不相同），
+ * 这里只负责插入、删除后的平衡和有序遍历，都是 O(log n)。
+ */
+typedef struct avl_node {
+    struct avl_node *left;
+    struct avl_node *right;
+    struct avl_node *parent;
+    int height;
+} avl_node_t;
+
+typedef struct {
+    avl_node_t *root;
+} avl_tree_t;
+
+#define AVL_TREE_INIT { NULL }
+
+#define avl_entry(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+// 返回 <0 表示 a 排在 b 前面
+typedef int (*avl_cmp_t)(const avl_node_t *a, const avl_node_t *b);
+
+void avl_insert(avl_tree_t *tree, avl_node_t *node, avl_cmp_t cmp);
+void avl_remove(avl_tree_t *tree, avl_node_t *node);
+
+avl_node_t *avl_first(const avl_tree_t *tree);
+avl_node_t *avl_last(const avl_tree_t *tree);
+avl_node_t *avl_next(const avl_node_t *node);
+avl_node_t *avl_prev(const avl_node_t *node);
+
+#endif
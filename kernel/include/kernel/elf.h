@@ -41,6 +41,30 @@ typedef struct {
     Elf32_Word  p_align;
 } Elf32_Phdr;
 
+/* ===== Section header ===== */
+typedef struct {
+    Elf32_Word  sh_name;
+    Elf32_Word  sh_type;
+    Elf32_Word  sh_flags;
+    Elf32_Addr  sh_addr;
+    Elf32_Off   sh_offset;
+    Elf32_Word  sh_size;
+    Elf32_Word  sh_link;
+    Elf32_Word  sh_info;
+    Elf32_Word  sh_addralign;
+    Elf32_Word  sh_entsize;
+} Elf32_Shdr;
+
+/* ===== Symbol table entry ===== */
+typedef struct {
+    Elf32_Word  st_name;
+    Elf32_Addr  st_value;
+    Elf32_Word  st_size;
+    uint8_t     st_info;
+    uint8_t     st_other;
+    Elf32_Half  st_shndx;
+} Elf32_Sym;
+
 /* ===== e_ident indexes ===== */
 enum {
     EI_MAG0       = 0,
@@ -78,6 +102,14 @@ enum {
 #define PT_NULL    0
 #define PT_LOAD    1
 
+/* ===== Section types ===== */
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+
+/* ===== Symbol types ===== */
+#define STT_FUNC   2
+#define ELF32_ST_TYPE(info) ((info) & 0xF)
+
 /* ===== Segment flags ===== */
 #define PF_X 0x1
 #define PF_W 0x2
@@ -93,4 +125,7 @@ typedef struct {
 int elf_load_from_memory(const void *image, size_t image_size, elf_load_result_t *out);
 
 /* 从 ext2 路径读取并加载 */
-int elf_load_from_file(const char *path, elf_load_result_t *out);
\ No newline at end of file
+int elf_load_from_file(const char *path, elf_load_result_t *out);
+
+/* 新建地址空间加载 path 并映射用户栈，成功后释放旧的用户地址空间 */
+int elf_exec(const char *path, uint32_t user_stack_top, elf_load_result_t *out);
\ No newline at end of file
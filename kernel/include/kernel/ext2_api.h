@@ -2,6 +2,7 @@
 #define _EXT2_API_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "kernel/ext2.h"
 
 typedef struct {
@@ -9,7 +10,6 @@ typedef struct {
     uint32_t pos;
     uint64_t size;
     struct ext2_inode inode;
-    int used;
 } ext2_file_t;
 
 // 目录项 v2（带 file_type 字段）
@@ -33,6 +33,9 @@ enum ext2_file_type {
     EXT2_FT_SYMLINK   = 7,
 };
 
+// 用户态看到的文件 fd = ext2 fd + EXT2_USER_FD_BASE（0-2 留给终端）
+#define EXT2_USER_FD_BASE 3
+
 int ext2_init(void);
 void ext2_selftest(void);
 size_t ext2_filesize(int fd);
@@ -40,4 +43,10 @@ int ext2_open(const char *path);
 int ext2_close(int fd);
 int ext2_read(int fd, void *buf, size_t count);
 
+// 已打开文件的 inode 信息（mmap 用），fd 无效返回 NULL
+const ext2_file_t *ext2_file(int fd);
+
+// 文件内第 idx 块的磁盘块号，空洞或不支持返回 0
+uint32_t ext2_bmap(const struct ext2_inode *inode, uint32_t idx);
+
 #endif
\ No newline at end of file
@@ -38,4 +38,12 @@ static inline void io_wait(void)
     outb(0x80, 0);
 }
 
+// 读时间戳计数器（TSC），用于 microbenchmark 计时
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
 #endif
\ No newline at end of file
@@ -1,7 +1,11 @@
 #ifndef _KERNEL_KEYBOARD_H
 #define _KERNEL_KEYBOARD_H 1
 
+#include <stdbool.h>
+
 void keyboard_isr(void);
 int keyboard_getchar(void);
+// Is a key waiting? Does not touch the interrupt flag (call with interrupts off).
+bool keyboard_has_input(void);
 
 #endif
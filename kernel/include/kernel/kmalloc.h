@@ -2,9 +2,12 @@
 #define _KMALLOC
 
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Allocate a block of at least `size` bytes (aligned to 8 bytes).
+ * Requests of a page or more get their own pages, which kfree() returns
+ * to the PMM immediately.
  * Returns a pointer to the usable memory, or NULL on failure.
  */
 void *kmalloc(size_t size);
@@ -21,4 +24,48 @@ void  kfree(void *ptr);
  */
 void  kmalloc_test(void);
 
+/**
+ * Boot-time microbenchmark: random kmalloc/kfree churn, reports average
+ * and worst-case cycles per call.
+ */
+void  kmalloc_bench(void);
+
+/*
+ * Heap profiler, compiled in with `make KPROF=1` (KERNEL_KMALLOC_PROFILE).
+ * Each kmalloc() is charged to its caller's return address; per-callsite
+ * live bytes/count, peak and alloc/free counts, plus a global latency
+ * histogram. Bucket 0 is < 64 cycles, bucket i is [2^(i+5), 2^(i+6)),
+ * the last bucket is >= 64K cycles.
+ */
+#define KMALLOC_LAT_BUCKETS 12
+#define KMALLOC_SYM_LEN     32
+
+typedef struct {
+    uint32_t caller;                 // return address of the kmalloc() call
+    uint32_t sym_off;                // caller - start of sym
+    char     sym[KMALLOC_SYM_LEN];   // function containing caller, "" if unknown
+    uint32_t live_bytes;
+    uint32_t live_count;
+    uint32_t peak_bytes;
+    uint32_t allocs;
+    uint32_t frees;
+} kmalloc_site_t;
+
+typedef struct {
+    uint32_t live_bytes;
+    uint32_t live_count;
+    uint32_t peak_bytes;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t fails;
+    uint32_t nr_sites;
+    uint32_t lat_hist[KMALLOC_LAT_BUCKETS];
+} kmalloc_prof_t;
+
+/**
+ * Fill *summary and up to `max` callsites in out[], biggest live bytes first.
+ * Returns the number of callsites written, or -1 if the profiler is not built in.
+ */
+int   kmalloc_profile(kmalloc_prof_t *summary, kmalloc_site_t *out, uint32_t max);
+
 #endif
\ No newline at end of file
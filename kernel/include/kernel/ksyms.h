@@ -0,0 +1,32 @@
+#ifndef _KSYMS_H
+#define _KSYMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kernel/multiboot.h"
+
+/*
+ * 内核符号表：用 GRUB 装进内存的 .symtab/.strtab（PMM 已经把那几页留出来了），
+ * 把内核代码地址翻成“函数名+偏移”，给 kmalloc profiler 之类的诊断输出用。
+ * 没有符号表时查什么都返回 NULL。
+ */
+
+/*
+ * GRUB 装进来的节头表、.symtab、.strtab 的物理区间 [start, end)。
+ * 三段都非空、都在 physmap 里（PMM_DIRECT_LIMIT 以下）才返回 true；
+ * pmm_init 按它保留这几页，ksyms_init 按它找符号表，两边的判断是同一份。
+ * mbd 是 physmap 里的虚拟地址
+ */
+#define KSYMS_BOOT_RANGES 3
+typedef struct { uint32_t start, end; } ksyms_range_t;
+
+bool ksyms_boot_ranges(const multiboot_info_t *mbd, ksyms_range_t out[KSYMS_BOOT_RANGES]);
+
+// 在 pmm_init 之后调用（要通过 physmap 读符号表），mbd 是 kernel_main 拿到的物理地址。
+// PMM 没有保留这几页（可能已经被分出去了）就不启用
+void ksyms_init(multiboot_info_t *mbd);
+
+// addr 所在函数的名字，*offset 是 addr 相对函数开头的偏移；找不到返回 NULL
+const char *ksyms_lookup(uint32_t addr, uint32_t *offset);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef _MMAN_H
+#define _MMAN_H
+
+#include <stdint.h>
+
+// 和 userlibc 的 <sys/mman.h> 保持一致
+#define PROT_NONE      0x0
+#define PROT_READ      0x1
+#define PROT_WRITE     0x2
+#define PROT_EXEC      0x4
+
+#define MAP_SHARED     0x01
+#define MAP_PRIVATE    0x02
+#define MAP_FIXED      0x10
+#define MAP_ANONYMOUS  0x20
+
+#define MAP_FAILED     ((void *)-1)
+
+// SYS_MMAP 参数太多，用户态把它们放在一个结构体里传指针进来
+typedef struct {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t prot;
+    uint32_t flags;
+    int32_t  fd;
+    uint32_t offset;
+} mmap_args_t;
+
+void *sys_mmap(const mmap_args_t *args);
+int sys_munmap(uintptr_t addr, uint32_t len);
+int sys_mprotect(uintptr_t addr, uint32_t len, uint32_t prot);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _PAGE_CACHE_H
+#define _PAGE_CACHE_H
+
+#include <stdint.h>
+#include "kernel/paging.h"   // phys_addr_t
+#include "kernel/vmm.h"
+
+/*
+ * 文件页缓存：每个 inode 一个 file_cache_t，按页号缓存文件内容。
+ * 同一个文件的同一页只读一次盘，所有 mmap 它的进程共享同一个物理页。
+ * 每个映射它的区域拿一份引用，最后一个区域没了，缓存连同缓存的页一起释放。
+ */
+typedef struct file_cache file_cache_t;
+
+// 按 ext2 的 fd 找到（或新建）这个 inode 的缓存，已经替调用者拿了一份引用
+file_cache_t *page_cache_file(int fd);
+void page_cache_put(file_cache_t *fc);
+
+uint32_t page_cache_nr_pages(const file_cache_t *fc);
+
+// 第 index 页的物理地址，已经替调用者 page_get 过；超出文件或读盘失败返回 0
+phys_addr_t page_cache_get_page(void *fc, uint32_t index);
+
+// 给 vmm_vma_map_source 用：data 是 file_cache_t
+extern const vmm_page_source_t page_cache_source;
+
+// 回收：丢掉最多 nr_pages 个没人映射的缓存页（都是干净的），返回丢了几页
+uint32_t page_cache_shrink(uint32_t nr_pages);
+
+#endif
@@ -3,8 +3,82 @@
 
 #include <stdint.h>
 
+/*
+ * 两种分页模式，编译时二选一（make PAE=1 -> KERNEL_PAE）：
+ *
+ *   经典 2 级：页目录 1024 项 -> 页表 1024 项，32 位表项，物理地址 32 位
+ *   PAE 3 级：PDPT 4 项 -> 页目录 512 项 -> 页表 512 项，64 位表项，物理地址 36 位
+ *
+ * PAE 下 4 个页目录在内存里连续放，当成一张 2048 项的大页目录来用，
+ * 这样 PDE_INDEX(va) = va >> 21，VMM 的代码两种模式都能共用。
+ */
+#ifdef KERNEL_PAE
+
+typedef uint64_t phys_addr_t;
+
+#define PAGE_DIR_ENTRIES   2048   // 4 个页目录 x 512 项
+#define PAGE_TABLE_ENTRIES 512
+#define PDPT_ENTRIES       4
+#define PDE_SHIFT          21     // 每个 PDE 管 2 MiB，大页也是 2 MiB
+
+// 页目录项（PDE）
+typedef struct __attribute__((packed)) {
+    uint64_t present     : 1;  // P
+    uint64_t rw          : 1;  // R/W
+    uint64_t user        : 1;  // U/S
+    uint64_t pwt         : 1;  // PWT
+    uint64_t pcd         : 1;  // PCD
+    uint64_t accessed    : 1;  // A
+    uint64_t dirty       : 1;  // 如果 PS=0，这位保留；如果 PS=1，表示大页“dirty”
+    uint64_t page_size   : 1;  // PS (0 = 4 KiB page table, 1 = 2 MiB page)
+    uint64_t global      : 1;  // G (only if PS=1)
+    uint64_t avail       : 3;  // 软件可用
+    uint64_t frame       :40;  // 物理页框号
+    uint64_t reserved    :11;
+    uint64_t nx          : 1;  // XD（需要 EFER.NXE，目前不用）
+} page_directory_entry_t;
+
+// 页表项（PTE）
+typedef struct __attribute__((packed)) {
+    uint64_t present   : 1;  // P
+    uint64_t rw        : 1;  // R/W
+    uint64_t user      : 1;  // U/S
+    uint64_t pwt       : 1;  // PWT
+    uint64_t pcd       : 1;  // PCD
+    uint64_t accessed  : 1;  // A
+    uint64_t dirty     : 1;  // D
+    uint64_t pat       : 1;  // PAT (only if 4 KiB page)
+    uint64_t global    : 1;  // G
+    uint64_t avail     : 3;  // 软件可用
+    uint64_t frame     :40;  // 物理页框号
+    uint64_t reserved  :11;
+    uint64_t nx        : 1;  // XD
+} page_table_entry_t;
+
+// PDPT 项：只有 P/PWT/PCD 和页目录地址，RW/US 位在 PAE 下是保留位
+typedef struct __attribute__((packed)) {
+    uint64_t present   : 1;
+    uint64_t reserved0 : 2;
+    uint64_t pwt       : 1;
+    uint64_t pcd       : 1;
+    uint64_t reserved1 : 4;
+    uint64_t avail     : 3;
+    uint64_t frame     :40;
+    uint64_t reserved2 :12;
+} pdpt_entry_t;
+
+// CR3 指向它，要求 32 字节对齐且在 4 GiB 以下
+typedef struct __attribute__((aligned(32))) {
+    pdpt_entry_t entries[PDPT_ENTRIES];
+} page_dir_pointer_table_t;
+
+#else
+
+typedef uint32_t phys_addr_t;
+
 #define PAGE_DIR_ENTRIES 1024
 #define PAGE_TABLE_ENTRIES 1024
+#define PDE_SHIFT        22       // 每个 PDE 管 4 MiB，PSE 大页也是 4 MiB（需要 CR4.PSE）
 
 // 页目录项（PDE）
 typedef struct __attribute__((packed)) {
@@ -36,7 +110,22 @@ typedef struct __attribute__((packed)) {
     uint32_t frame     :20;  // 物理页框号（高 20 位）
 } page_table_entry_t;
 
-// 页表：一页 4 KiB，共 1024 个 PTE
+#endif // KERNEL_PAE
+
+_Static_assert(sizeof(page_table_entry_t) == sizeof(phys_addr_t), "PTE size must match paging mode");
+_Static_assert(sizeof(page_directory_entry_t) == sizeof(phys_addr_t), "PDE size must match paging mode");
+
+// PS=1 的 PDE 直接映射一整个大页
+#define LARGE_PAGE_SIZE (1U << PDE_SHIFT)
+
+// 虚拟地址 -> 页目录下标 / 页表下标
+#define PDE_INDEX(va) ((uint32_t)(va) >> PDE_SHIFT)
+#define PTE_INDEX(va) (((uint32_t)(va) >> 12) & (PAGE_TABLE_ENTRIES - 1))
+
+// 表项里的页框号 -> 物理地址（先转成 phys_addr_t 再移位，PAE 下不会截断）
+#define FRAME_TO_PHYS(frame) ((phys_addr_t)(frame) << 12)
+
+// 页表：一页 4 KiB
 typedef struct __attribute__((aligned(4096))) {
     page_table_entry_t pages[PAGE_TABLE_ENTRIES];
 } page_table_t;
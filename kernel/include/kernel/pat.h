@@ -0,0 +1,21 @@
+#ifndef _PAT_H
+#define _PAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * PAT（Page Attribute Table）：PTE 的 PAT/PCD/PWT 三位组成下标，选 IA32_PAT 里的一种内存类型。
+ * 下标 0-3 和上电默认值一样（WB/WT/UC-/UC），只把 4 改成 WC，
+ * 所以没设过 PAT 位的旧映射含义不变。VMM_CACHE_* 的数值就是这个下标。
+ */
+void pat_init(void);
+bool pat_supported(void);
+
+// VMM_CACHE_* 在 flags 里的值 -> PTE 用的下标；CPU 不支持 PAT 时 WC 退成 UC-
+uint32_t pat_index(uint32_t flags);
+
+// 启动时 microbenchmark：VGA 文本缓冲区分别用 WB/WT/UC/WC 时整屏写入的 cycles
+void pat_bench(void);
+
+#endif
@@ -2,12 +2,116 @@
 #define _PMM
 
 #include "multiboot.h"
+#include "paging.h"     // phys_addr_t：经典分页 32 位，PAE 64 位
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// buddy 最大阶：2^10 页 = 4 MiB
+#define PMM_MAX_ORDER 10
+
+// 物理内存分区，边界都按 4 MiB 对齐
+#define PMM_DMA_LIMIT       0x01000000U   // ISA DMA 只能访问 16 MiB 以下
+#define PMM_BOOT_MAP_LIMIT  0x01000000U   // boot.S 用 4 KiB 页表映射的物理 [0, 16 MiB)
+#define PMM_DIRECT_LIMIT    0x30000000U   // physmap：低端内存 [0, 768 MiB) 映射在 0xC0000000（整块的用大页）
+#define PMM_VGA_ALIAS_FRAME 0x3FFU        // 0xC03FF000 映射的是 VGA，不是物理页 0x3FF000
+
+enum {
+    PMM_ZONE_DMA    = 0,   // [0, PMM_DMA_LIMIT)
+    PMM_ZONE_NORMAL = 1,   // [PMM_DMA_LIMIT, PMM_DIRECT_LIMIT)，直接映射
+    PMM_ZONE_HIGH   = 2,   // PMM_DIRECT_LIMIT 以上（PAE 下包括 4 GiB 以上），必须建映射才能访问
+    PMM_NR_ZONES    = 3,
+};
+
+/*
+ * 每个物理页一个描述符，按页号排成数组（每页 8 字节）。
+ * refcount 为 0 表示空闲；pmm_alloc_* 分出来的页 refcount = 1。
+ * owner 指回拥有这页的映射或 inode，由使用者自己解释。
+ */
+struct page {
+    uint16_t refcount;
+    uint16_t flags;     // PG_*
+    void    *owner;
+};
+
+_Static_assert(sizeof(struct page) <= 8, "struct page must stay within 8 bytes");
+
+#define PG_RESERVED  (1 << 0)   // 内核镜像、PMM 元数据、空洞等，永远不释放
+#define PG_PINNED    (1 << 1)   // 不能被换出/回收
+#define PG_ANON      (1 << 2)   // 匿名页（用户堆/栈/bss）
+#define PG_FILE      (1 << 3)   // 文件页，owner 指向 inode/页缓存
+#define PG_PAGETABLE (1 << 4)   // 页表/页目录
 
 void pmm_init(multiboot_info_t* mbd, uint32_t magic);
-uint32_t pmm_alloc_frame(void);
-void pmm_free_frame(uint32_t physaddr);
+phys_addr_t pmm_alloc_frame(void);
+void pmm_free_frame(phys_addr_t physaddr);   // 还有别的引用时只减引用计数，和 page_put 一样
 void pmm_test_frame(uint32_t physaddr);
 
+// 分配/释放 2^order 个物理连续页（按块大小对齐），失败返回 0
+phys_addr_t pmm_alloc_pages(uint32_t order);
+void pmm_free_pages(phys_addr_t physaddr, uint32_t order);
+
+// 按区分配：先用 zone，不够再退到更低的区（HIGH -> NORMAL -> DMA）
+// pmm_alloc_frame()/pmm_alloc_pages() 相当于 zone = PMM_ZONE_HIGH
+phys_addr_t pmm_alloc_frame_zone(uint32_t zone);
+phys_addr_t pmm_alloc_pages_zone(uint32_t order, uint32_t zone);
+
+// 分一个物理地址低于 limit 的页，例如 PMM_DIRECT_LIMIT / PMM_DMA_LIMIT
+phys_addr_t pmm_alloc_frame_below(uint32_t limit);
+
+void pmm_dump_zones(void);
+
+// 所有区的空闲页数（回收水位用）
+uint32_t pmm_free_frames(void);
+
+// pmm_init 有没有把 GRUB 装进来的内核符号表（ksyms_boot_ranges 那三段）留下来
+bool pmm_boot_symbols_reserved(void);
+
+// 页描述符：物理地址 <-> struct page，以及引用计数
+struct page *pmm_page(phys_addr_t physaddr);
+phys_addr_t pmm_page_phys(const struct page *pg);
+void page_get(struct page *pg);
+void page_put(struct page *pg);   // 减到 0 时释放这页
+
+// 清零过的单页（直接映射区内），优先从预清零池里拿，池空才现场清零
+phys_addr_t pmm_alloc_zeroed_frame(void);
+
+// 按 4 字节（rep stosl）清零直接映射区内的物理 [phys, phys + bytes)，bytes 是 4 的倍数
+void pmm_zero_range(phys_addr_t phys, uint32_t bytes);
+
+// 空闲循环里调用：补充预清零池一页；没什么可补的返回 false
+bool pmm_idle(void);
+
+typedef struct {
+    uint32_t pooled;    // 池里现有的页数
+    uint32_t hits;      // 直接从池里拿到
+    uint32_t misses;    // 池空，现场清零
+} pmm_zero_pool_stats_t;
+
+void pmm_zero_pool_stats(pmm_zero_pool_stats_t *st);
+
+// meminfo：整体统计 + pmm_alloc_frame 的延迟直方图
+// 延迟桶：桶 0 是 < 64 cycles，桶 i 是 [2^(i+5), 2^(i+6))，最后一桶是 >= 64K cycles
+#define PMM_LAT_BUCKETS 12
+
+typedef struct {
+    uint32_t total_frames;      // 可分配的页数（不含内核镜像、元数据、空洞）
+    uint32_t free_frames;
+    uint32_t used_frames;
+    uint32_t largest_free_run;  // 最长连续空闲页数
+    uint32_t frag_score;        // 0-100，100 - largest_free_run * 100 / free_frames
+    uint32_t alloc_count;       // 分配/释放调用次数（单页和多页都算一次）
+    uint32_t free_count;
+    uint32_t zero_pooled;       // 预清零池
+    uint32_t zero_hits;
+    uint32_t zero_misses;
+    uint32_t alloc_lat_hist[PMM_LAT_BUCKETS];
+} pmm_stats_t;
+
+void pmm_get_stats(pmm_stats_t *st);
+
+// 启动时 microbenchmark：不同占用率下单页 alloc/free 的 cycles
+void pmm_bench(void);
+
 
 #endif
\ No newline at end of file
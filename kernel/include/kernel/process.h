@@ -0,0 +1,41 @@
+#ifndef _PROCESS_H
+#define _PROCESS_H
+
+#include <stdint.h>
+#include "kernel/registers.h"
+#include "kernel/vmm.h"
+#include "kernel/user_heap.h"
+
+/*
+ * 进程：没有调度器，fork 出来的子进程先跑，父进程停在 fork 里，
+ * 子进程 exit 以后再切回父进程，fork 返回子进程的 pid。
+ */
+typedef struct process {
+    uint32_t pid;
+    struct process *parent;
+    address_space_t *as;        // 停下来的父进程的地址空间（正在跑的进程看 vmm_as_current()）
+    user_heap_state_t heap;     // 停下来时的堆状态
+    registers_t frame;          // 停下来时 fork 系统调用的寄存器
+} process_t;
+
+process_t *process_current(void);
+
+// fork：regs 是父进程的系统调用帧，返回后 regs 已经是子进程的（eax = 0）
+int process_fork(registers_t *regs);
+
+// exit：切回父进程，regs 换成父进程停在 fork 里的帧；没有父进程返回 -1
+int process_exit(registers_t *regs, int status);
+
+/*
+ * 空闲：当前进程要等键盘输入。把系统调用帧存下来（eip 退回到 int $0x80，
+ * 醒来后重新执行这次 read），丢掉系统调用的栈，在内核栈顶跑空闲循环：
+ * 补预清零页池，没活干就 hlt。键盘中断里 process_wake_input 把存下来的帧
+ * 换进中断帧，iret 直接回到用户态。
+ */
+void process_wait_input(const registers_t *regs) __attribute__((noreturn));
+void process_wake_input(registers_t *regs);
+
+// 没有进程可跑了（最后一个进程也退出了）：一直待在空闲循环里
+void process_idle(void) __attribute__((noreturn));
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _REGISTERS_H
+#define _REGISTERS_H
+
+#include <stdint.h>
+
+/*
+ * Stack frame built by the interrupt / syscall stubs (pusha + vector + error
+ * code) followed by what the CPU pushes. useresp/ss are only valid when the
+ * interrupt came from ring 3.
+ */
+typedef struct registers {
+    uint32_t edi;         // Last pushed by PUSHAD (lowest memory address)
+    uint32_t esi;
+    uint32_t ebp;
+    uint32_t esp;         // Original ESP (pushed by PUSHAD)
+    uint32_t ebx;
+    uint32_t edx;
+    uint32_t ecx;
+    uint32_t eax;         // First pushed by PUSHAD (highest memory address)
+    uint32_t int_num;      // Manually pushed interrupt number (e.g., 32 for IRQ0)
+    uint32_t dummy_error; // Manually pushed dummy error code (e.g., 0)
+    uint32_t eip;
+    uint32_t cs;
+    uint32_t eflags;
+    uint32_t useresp;
+    uint32_t ss;
+} registers_t;
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * slab 对象缓存：同一种定长对象（inode 缓冲、目录块缓冲、fd 状态、VMA……）
+ * 各用一个 kmem_cache。每个 slab 是 buddy 分来的一块物理连续页（在 physmap 里），
+ * 开头放 slab 描述符，后面切成一个个对象；空闲对象自己串成链，对象前面没有头。
+ * 分配/释放都是 O(1)：从部分使用的 slab 里摘一个，还回去再挂上。
+ * 每个新 slab 的对象起点错开若干个 cache line（着色），不同 slab 的同号对象不挤在同一组 cache set 里。
+ */
+#define SLAB_CACHE_LINE     64
+
+// 对象按 cache line 对齐
+#define SLAB_HWCACHE_ALIGN  (1U << 0)
+
+typedef struct kmem_cache kmem_cache_t;
+
+typedef struct {
+    const char *name;
+    uint32_t obj_size;          // 创建时要的大小
+    uint32_t size;              // 实际占用（对齐、空闲链指针）
+    uint32_t order;             // 每个 slab 2^order 页
+    uint32_t per_slab;          // 每个 slab 的对象数
+    uint32_t colours;           // 着色有几档
+    uint32_t active_objs;       // 正在用的对象
+    uint32_t total_objs;        // 所有 slab 的对象总数
+    uint32_t slabs;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t grows;             // 新分配的 slab
+    uint32_t shrinks;           // 还给 PMM 的空 slab
+    uint32_t fail_count;
+} kmem_cache_stats_t;
+
+/*
+ * align 为 0 时按 8 字节对齐；ctor 在 slab 刚建好时对每个对象调用一次，
+ * 之后对象释放时应当已经回到构造好的状态（空闲链指针放在对象后面，不会破坏它）。
+ * 对象太大放不进一个 2^SLAB_MAX_ORDER 页的 slab 时返回 NULL。
+ */
+#define SLAB_MAX_ORDER 3
+
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                uint32_t flags, void (*ctor)(void *));
+// 还有对象没释放时返回 -1，什么都不做
+int   kmem_cache_destroy(kmem_cache_t *cache);
+
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void  kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+void kmem_cache_get_stats(const kmem_cache_t *cache, kmem_cache_stats_t *st);
+void kmem_cache_dump(void);
+
+// 启动时 microbenchmark：定长对象 kmalloc/kfree 和 kmem_cache_alloc/free 的 cycles
+void slab_bench(void);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef _SWAP_H
+#define _SWAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 交换区：磁盘上 ext2 文件系统结尾之后的扇区，按页切成交换槽。
+ * 换出的用户页 PTE 变成不存在的交换项（frame 里放槽号），缺页时读回来。
+ * 这里只管槽的分配和读写，挑哪一页换出（clock 扫描）在 vmm 里。
+ */
+#define SWAP_MAX_SLOTS 8192          // 最多 32 MiB
+
+typedef struct {
+    uint32_t total_slots;
+    uint32_t used_slots;
+    uint32_t swap_outs;         // 写出的页数
+    uint32_t swap_ins;          // 缺页读回的页数
+    uint32_t scanned;           // clock 看过的 PTE
+    uint32_t referenced;        // 其中 Accessed 位为 1、又得到一次机会的
+    uint32_t alloc_fail;        // 交换区满
+    uint32_t io_errors;         // 读写交换区时磁盘报错
+} swap_stats_t;
+
+// 在 ext2_init 之后调用：文件系统后面没有空间就不开交换
+void swap_init(void);
+bool swap_enabled(void);
+
+// 分一个槽（引用计数 1），满了返回 -1
+int  swap_alloc(void);
+void swap_dup(uint32_t slot);    // fork 后父子两边的交换项共用一个槽
+void swap_free(uint32_t slot);   // 引用计数减到 0 时槽才空出来
+
+// 磁盘报错返回 -1：写失败时页要留在内存里，读失败时页里的数据不能用
+int  swap_write_page(uint32_t slot, const void *page);
+int  swap_read_page(uint32_t slot, void *page);
+
+void swap_account_scan(uint32_t scanned, uint32_t referenced);
+void swap_get_stats(swap_stats_t *st);
+
+#endif
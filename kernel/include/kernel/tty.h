@@ -2,6 +2,7 @@
 #define _KERNEL_TTY_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 void terminal_initialize(void);
 void terminal_clear(void);
@@ -9,4 +10,7 @@ void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
 
+// VGA 文本缓冲区的虚拟地址（boot.S 映射在内核页表里）
+uintptr_t terminal_vram(void);
+
 #endif
@@ -6,4 +6,14 @@
 void user_heap_init(void);
 void *sys_sbrk(intptr_t increment);
 
+// 堆的 break 跟着进程走：fork 出去的子进程退出后把父进程的恢复回来
+typedef struct {
+    uintptr_t start;
+    uintptr_t brk;
+    uintptr_t limit;
+} user_heap_state_t;
+
+void user_heap_save(user_heap_state_t *st);
+void user_heap_restore(const user_heap_state_t *st);
+
 #endif
\ No newline at end of file
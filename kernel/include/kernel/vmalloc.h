@@ -0,0 +1,44 @@
+#ifndef _VMALLOC_H
+#define _VMALLOC_H
+
+#include <stdint.h>
+#include "kernel/pmm.h"
+
+/*
+ * 内核虚拟地址区间分配器（vmalloc 区）：physmap 之后到 VMALLOC_END 的内核 VA
+ * 按页分配、释放后回收再用。只管地址，不管映射和物理页。
+ */
+#define VMALLOC_START   (0xC0000000U + PMM_DIRECT_LIMIT)
+#define VMALLOC_END     0xFFC00000U          // 最后 4 MiB 不用
+
+// 分配时在尾部多留一页不映射的保护页，越界访问直接缺页
+#define VMALLOC_GUARD   (1U << 9)
+
+typedef struct {
+    uint32_t total_pages;       // 整个 vmalloc 区
+    uint32_t used_pages;        // 已分配（含保护页）
+    uint32_t guard_pages;
+    uint32_t free_pages;
+    uint32_t nr_areas;          // 已分配的区间数
+    uint32_t nr_free_ranges;    // 空闲区间数（碎片程度）
+    uint32_t largest_free;      // 最大空闲区间（页）
+    uint32_t alloc_count;
+    uint32_t free_count;
+    uint32_t fail_count;
+} vmalloc_stats_t;
+
+void vmalloc_init(void);
+
+// 分配 npages 页的 VA（flags 可带 VMALLOC_GUARD），失败返回 0
+uintptr_t vmalloc_va_alloc(uint32_t npages, uint32_t flags);
+
+// 释放 vmalloc_va_alloc 返回的区间，返回它的页数（不含保护页），找不到返回 0
+uint32_t vmalloc_va_free(uintptr_t va);
+
+void vmalloc_get_stats(vmalloc_stats_t *out);
+void vmalloc_dump(void);
+
+// 启动时 microbenchmark：随机大小反复分配/释放，看 VA 是否全部收回
+void vmalloc_bench(void);
+
+#endif
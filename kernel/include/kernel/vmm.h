@@ -3,12 +3,117 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "kernel/paging.h"   // phys_addr_t
 
 void vmm_init();
 
-int vmm_map_page(uintptr_t vaddr, uintptr_t paddr, uint32_t flags);
+/*
+ * 映射的内存类型：flags 里 VMM_CACHE_SHIFT 开始的 3 位，数值就是 PAT 下标（见 pat.h）。
+ * 不写就是 WB。显存、framebuffer、设备 BAR 这类只写的区域用 WC。
+ * 只对 4 KiB 页有效，大页总是 WB。
+ */
+#define VMM_CACHE_SHIFT    4
+#define VMM_CACHE_MASK     (7U << VMM_CACHE_SHIFT)
+#define VMM_CACHE_WB       (0U << VMM_CACHE_SHIFT)
+#define VMM_CACHE_WT       (1U << VMM_CACHE_SHIFT)
+#define VMM_CACHE_UC_MINUS (2U << VMM_CACHE_SHIFT)   // UC，但 MTRR 可以把它降成 WC
+#define VMM_CACHE_UC       (3U << VMM_CACHE_SHIFT)
+#define VMM_CACHE_WC       (4U << VMM_CACHE_SHIFT)
 
-uint32_t vmm_translate(uintptr_t vaddr);
+int vmm_map_page(uintptr_t vaddr, phys_addr_t paddr, uint32_t flags);
+
+// 改已经映射的 [vaddr, vaddr + npages 页) 的内存类型，有没映射的页返回 -1
+int vmm_set_cache(uintptr_t vaddr, uint32_t npages, uint32_t cache);
+
+phys_addr_t vmm_translate(uintptr_t vaddr);
+
+// 给用户页分一帧（physmap 内）：内存紧张时先回收，zeroed 时从预清零池拿
+phys_addr_t vmm_alloc_user_frame(bool zeroed);
+
+// 用大页映射一段内核区域，地址和大小都要按 LARGE_PAGE_SIZE 对齐
+int vmm_map_large(uintptr_t vaddr, phys_addr_t paddr, uint32_t size, uint32_t flags);
+
+// physmap：低端内存的物理 [start, end) 映射到 0xC0000000 + phys，整块的用大页（pmm_init 调用）
+void vmm_map_physmap(uint32_t start, uint32_t end);
+
+// 地址空间：用户半边每个进程一份，内核半边共享
+typedef struct address_space address_space_t;
+
+address_space_t *vmm_as_create(void);
+void vmm_as_destroy(address_space_t *as);   // 不能是当前或内核地址空间
+void vmm_as_switch(address_space_t *as);
+address_space_t *vmm_as_current(void);
+address_space_t *vmm_as_kernel(void);
+address_space_t *vmm_as_fork(void);         // 复制当前用户地址空间，数据页写时复制
+
+/*
+ * VMA：当前用户地址空间里的区域（ELF 段、堆、栈、mmap），按需分配：
+ * 区域内缺页时才分配物理页，读先映射共享零页，写才给一页新的清零页。
+ * flags 是 VMM_RW / VMM_USER，不带 VMM_USER 的区域不能访问（PROT_NONE）。
+ */
+int vmm_vma_add(uintptr_t start, uintptr_t end, uint32_t flags);
+int vmm_vma_resize(uintptr_t start, uintptr_t new_end);
+
+// 匿名映射：fixed 时用 *addr（原来的映射先拆掉），否则找一个空洞，地址写回 *addr
+int vmm_vma_map(uintptr_t *addr, uint32_t len, uint32_t flags, bool fixed);
+
+/*
+ * 文件映射：缺页时调 get_page(data, 页号) 拿一个已经 page_get 过的页，只读映射。
+ * 每个区域拿着 data 的一份引用：区域拆开、fork 复制时 hold，区域删掉时 release。
+ * 映射成功后调用者手里的那份引用归区域，失败时还是调用者的
+ */
+typedef struct {
+    phys_addr_t (*get_page)(void *data, uint32_t index);
+    void (*hold)(void *data);
+    void (*release)(void *data);
+} vmm_page_source_t;
+
+int vmm_vma_map_source(uintptr_t *addr, uint32_t len, uint32_t flags, bool fixed,
+                       const vmm_page_source_t *source, void *data, uint32_t pgoff);
+int vmm_vma_unmap(uintptr_t start, uintptr_t end);
+int vmm_vma_protect(uintptr_t start, uintptr_t end, uint32_t flags);
+
+// 缺页处理：addr 是 CR2，err 是错误码；处理掉了返回 0
+// 空闲页不多时用 clock 算法挑冷的匿名页压缩进 zram 或换出到交换区，换出的页也在这里读回来
+int vmm_handle_fault(uintptr_t addr, uint32_t err);
+
+/*
+ * 用户大页：可写匿名区域（堆、匿名 mmap）里整块对齐的 LARGE_PAGE_SIZE 范围
+ * 第一次缺页时直接用 PS=1 的大页映射，分不到连续内存就退回 4 KiB 页。
+ * fork、部分 munmap/mprotect 时拆成普通页表。
+ */
+typedef struct {
+    uint32_t mapped;        // 现在映射着的用户大页
+    uint32_t faults;        // 缺页时直接给了大页
+    uint32_t fallbacks;     // 范围合适但分不到连续内存，退回 4 KiB
+    uint32_t splits;        // 拆成 4 KiB 页表
+    uint32_t frees;         // 整个大页释放
+} vmm_huge_stats_t;
+
+void vmm_get_huge_stats(vmm_huge_stats_t *st);
+
+/*
+ * vmstat：全局和每个地址空间各一份，内核半边的映射记在内核地址空间上。
+ * faults 是进 vmm_handle_fault 的次数，处理掉的再分成 minor / major / zero 三类；
+ * pt_pages 是现在占着的页表页数，其余都是累计值。
+ */
+typedef struct {
+    uint32_t faults;
+    uint32_t faults_minor;      // COW、文件页：页本来就在内存里
+    uint32_t faults_major;      // 从 zram 或交换区读回
+    uint32_t faults_zero;       // 零页、新的清零页、大页
+    uint32_t invlpg;
+    uint32_t tlb_flushes;       // 整体冲刷（重载 CR3 或拨 CR4.PGE）
+    uint32_t pages_mapped;      // 映射上的 4 KiB 页（大页按 4 KiB 页数算）
+    uint32_t pages_unmapped;
+    uint32_t pt_pages;
+} vmstat_t;
+
+// global / as 都可以是 NULL；as 拿的是当前地址空间的
+void vmm_get_vmstat(vmstat_t *global, vmstat_t *as);
+
+// 启动时 microbenchmark：有/没有 Global 页时 CR3 切换的代价
+void vmm_bench(void);
 
 int vmm_unmap_page(uintptr_t vaddr, bool free_frame);
 
@@ -21,6 +126,29 @@ int vmm_unmap_region(uintptr_t vstart,
                      uintptr_t vend,
                      bool free_frames);
 
+/*
+ * 批量 unmap：先清 PTE、收集要失效的地址和要释放的页，tlb_gather_flush()
+ * 时一次性冲 TLB（超过 TLB_GATHER_MAX 页改成整体冲刷），然后才释放页和清空的页表。
+ */
+#define TLB_GATHER_MAX    64
+#define TLB_GATHER_TABLES 8
+
+typedef struct {
+    uint32_t    nr_va;
+    uintptr_t   va[TLB_GATHER_MAX];           // 要 invlpg 的地址
+    bool        flush_all;                    // 超过 TLB_GATHER_MAX，改成整体冲刷
+    bool        global;                       // 有内核 Global 映射，整体冲刷时要连它们一起冲
+    uint32_t    nr_frames;
+    phys_addr_t frames[TLB_GATHER_MAX];       // 冲刷后 page_put 的数据页
+    uint32_t    nr_tables;
+    uint32_t    tables[TLB_GATHER_TABLES];    // 冲刷后释放的空页表
+} tlb_gather_t;
+
+void tlb_gather_init(tlb_gather_t *tlb);
+int  vmm_unmap_page_gather(tlb_gather_t *tlb, uintptr_t vaddr, bool free_frame);
+void vmm_unmap_range_gather(tlb_gather_t *tlb, uintptr_t start, uintptr_t end, bool free_frames);
+void tlb_gather_flush(tlb_gather_t *tlb);
+
 // void vmm_test();
 
 void vmm_test_region(void);
@@ -29,7 +157,7 @@ typedef struct {
     bool     present;   // PTE.P present?
     bool     writable;  // PTE.RW writable?
     bool     user;      // PTE.U user-accessible?
-    uintptr_t paddr;    // 物理页基址（仅当 present 时有效）
+    phys_addr_t paddr;  // 物理页基址（仅当 present 时有效）
 } vmm_page_info_t;
 
 void dump_boot_pte(uint32_t va);
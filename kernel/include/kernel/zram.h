@@ -0,0 +1,42 @@
+#ifndef _ZRAM_H
+#define _ZRAM_H
+
+#include <stdint.h>
+
+/*
+ * zram：内存里的压缩页池。回收时冷的匿名页先试着压缩放进来（PTE 标成压缩项，
+ * frame 里放句柄），缺页时解压回一页新的；压不动或池满了才写交换区。
+ * 压缩用 LZ4 风格的字节流 LZ77；整页都是同一个 32 位值的页只记这个值。
+ */
+#define ZRAM_MAX_PAGES       8192               // 句柄数
+#define ZRAM_POOL_MAX_BYTES  (8U << 20)         // 池里压缩数据的上限
+#define ZRAM_MAX_COMPRESSED  2016               // 压完比这大就不要了：一个池页至少要放两块
+
+// 缺页延迟桶：桶 0 是 < 512 cycles，桶 i 是 [2^(i+8), 2^(i+9))，最后一桶是 >= 512K cycles
+#define ZRAM_LAT_BUCKETS 12
+
+typedef struct {
+    uint32_t stored_pages;      // 池里现在的页数（含同值页）
+    uint32_t same_pages;        // 其中整页同值、不占池空间的
+    uint32_t compr_bytes;       // 压缩数据总字节数
+    uint32_t pool_bytes;        // 池页占用的字节数（含页头和块尾的浪费）
+    uint32_t ratio_x100;        // 压缩比 * 100：原始大小 / 压缩后大小
+    uint32_t stores;
+    uint32_t loads;
+    uint32_t rejected;          // 压不动，交给交换区
+    uint32_t pool_full;         // 池满或句柄用完
+    uint32_t fault_max_cycles;  // 缺页读回（分页 + 解压）最长一次
+    uint32_t fault_lat_hist[ZRAM_LAT_BUCKETS];
+} zram_stats_t;
+
+// 压缩一页放进池里，返回句柄（引用计数 1）；压不动或池满返回 -1
+int  zram_store(const void *page);
+// 解压到 page，数据坏了返回 -1
+int  zram_load(uint32_t handle, void *page);
+void zram_dup(uint32_t handle);
+void zram_free(uint32_t handle);
+
+void zram_account_fault(uint32_t cycles);
+void zram_get_stats(zram_stats_t *st);
+
+#endif
@@ -8,6 +8,7 @@
 #include "kernel/kmalloc.h"
 #include "kernel/vmm.h"
 #include "kernel/pmm.h"
+#include "kernel/user_heap.h"
 
 /* ========== 你需要按自己工程替换/对接的部分开始 ========== */
 
@@ -102,21 +103,26 @@ static int elf_map_segment_pages(uint32_t seg_vaddr, uint32_t seg_memsz, uint32_
 
     uint32_t page_flags = VMM_PRESENT | VMM_USER | VMM_RW;
 
+    /*
+     * 地址空间是新建的，已经映射过的页只可能是和上一个 PT_LOAD 段共用的那一页，
+     * 里面已经拷好了上一段的尾巴，不能清零；新页本来就是清零过的
+     */
     for (uint32_t va = map_start; va < map_end; va += PAGE_SIZE) {
         if (!vmm_translate(va)) {
-            uint32_t phys = pmm_alloc_frame();
+            /* 新页从预清零池里拿，不用再清；内存不够时和缺页一样先回收 */
+            phys_addr_t phys = vmm_alloc_user_frame(true);
             if (!phys) {
                 kprintf("ELF: pmm_alloc_page failed\n");
                 return -1;
             }
+            /* 私有副本，和匿名页一样可以换出 */
+            pmm_page(phys)->flags |= PG_ANON;
             if (vmm_map_page(va, phys, page_flags) < 0) {
                 kprintf("ELF: vmm_map_page failed for va=0x%x\n", va);
+                pmm_free_frame(phys);
                 return -1;
             }
         }
-
-        /* 映射完后把整页清零，避免脏数据 */
-        kmemset((void *)va, 0, PAGE_SIZE);
     }
 
     return 0;
@@ -135,6 +141,7 @@ int elf_load_from_memory(const void *image, size_t image_size, elf_load_result_t
     const Elf32_Phdr *phdrs = (const Elf32_Phdr *)(file + eh->e_phoff);
 
     uint32_t max_loaded_end = 0;
+    uint32_t vma_end = 0;
     
 
     for (uint32_t i = 0; i < eh->e_phnum; i++) {
@@ -160,9 +167,29 @@ int elf_load_from_memory(const void *image, size_t image_size, elf_load_result_t
         }
 
         /*
-         * 先把这个 segment 覆盖的用户虚拟地址范围映射好
+         * 整个段登记成一个区域（和上一个段共用的页算在上一个段里）；
+         * 文件里有内容的那几页现在映射好，后面纯 .bss 的整页第一次访问时才分配。
+         * 先都登记成可写，拷完内容后再按 p_flags 收权限
          */
-        if (elf_map_segment_pages(ph->p_vaddr, ph->p_memsz, ph->p_flags) < 0) {
+        uint32_t file_end = ph->p_vaddr + ph->p_filesz;
+        uint32_t seg_end  = ph->p_vaddr + ph->p_memsz;
+        uint32_t bss_page = ALIGN_UP(file_end, PAGE_SIZE);
+        uint32_t eager_end = seg_end < bss_page ? seg_end : bss_page;
+
+        uint32_t vma_start = ALIGN_DOWN(ph->p_vaddr, PAGE_SIZE);
+        if (vma_start < vma_end) {
+            vma_start = vma_end;
+        }
+        if (vma_start < ALIGN_UP(seg_end, PAGE_SIZE)) {
+            if (vmm_vma_add(vma_start, seg_end, VMM_RW | VMM_USER) < 0) {
+                kprintf("ELF: cannot register segment at 0x%x\n", vma_start);
+                return -1;
+            }
+            vma_end = ALIGN_UP(seg_end, PAGE_SIZE);
+        }
+
+        if (eager_end > ph->p_vaddr &&
+            elf_map_segment_pages(ph->p_vaddr, eager_end - ph->p_vaddr, ph->p_flags) < 0) {
             return -1;
         }
 
@@ -175,14 +202,12 @@ int elf_load_from_memory(const void *image, size_t image_size, elf_load_result_t
         }
 
         /*
-         * .bss 或 memsz > filesz 的部分清零
-         * 虽然前面整页清过一次，这里还是把逻辑上段内剩余部分明确清零
+         * .bss 和文件内容共用的那一页，把段内剩余部分明确清零
          */
-        if (ph->p_memsz > ph->p_filesz) {
-            kmemset((void *)(ph->p_vaddr + ph->p_filesz), 0, ph->p_memsz - ph->p_filesz);
+        if (eager_end > file_end) {
+            kmemset((void *)file_end, 0, eager_end - file_end);
         }
 
-        uint32_t seg_end = ph->p_vaddr + ph->p_memsz;
         if (seg_end > max_loaded_end) {
             max_loaded_end = seg_end;
         }
@@ -196,6 +221,41 @@ int elf_load_from_memory(const void *image, size_t image_size, elf_load_result_t
         return -1;
     }
 
+    /*
+     * 内容都拷好了，再按 p_flags 把没有 PF_W 的段降成只读（CR0.WP 开着，拷贝时只能先可写）。
+     * 和可写段共用的头尾页保持可写
+     */
+    for (uint32_t i = 0; i < eh->e_phnum; i++) {
+        const Elf32_Phdr *ph = &phdrs[i];
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0 || (ph->p_flags & PF_W)) {
+            continue;
+        }
+
+        uint32_t ro_start = ALIGN_DOWN(ph->p_vaddr, PAGE_SIZE);
+        uint32_t ro_end   = ALIGN_UP(ph->p_vaddr + ph->p_memsz, PAGE_SIZE);
+        for (uint32_t j = 0; j < eh->e_phnum; j++) {
+            const Elf32_Phdr *w = &phdrs[j];
+            if (w->p_type != PT_LOAD || w->p_memsz == 0 || !(w->p_flags & PF_W)) {
+                continue;
+            }
+            uint32_t w_start = ALIGN_DOWN(w->p_vaddr, PAGE_SIZE);
+            uint32_t w_end   = ALIGN_UP(w->p_vaddr + w->p_memsz, PAGE_SIZE);
+            if (w_start >= ro_end || w_end <= ro_start) {
+                continue;
+            }
+            if (w_start <= ro_start) {
+                ro_start = w_end;
+            } else {
+                ro_end = w_start;
+            }
+        }
+
+        if (ro_start < ro_end && vmm_vma_protect(ro_start, ro_end, VMM_USER) < 0) {
+            kprintf("ELF: cannot write-protect segment at 0x%x\n", ro_start);
+            return -1;
+        }
+    }
+
     out->entry      = eh->e_entry;
     out->heap_start = ALIGN_UP(max_loaded_end, PAGE_SIZE);
     out->heap_end   = out->heap_start;
@@ -240,3 +300,52 @@ int elf_load_from_file(const char *path, elf_load_result_t *out) {
     kfree(buf);
     return ret;
 }
+
+/*
+ * exec：在一个新的地址空间里加载 path，用户栈（栈顶 user_stack_top）登记成
+ * 按需分配的区域，往下最多长到 USER_STACK_MAX。
+ * 成功后留在新地址空间，旧的用户地址空间整个释放；失败时切回原来的
+ * 地址空间，什么都不变。path 可能是旧地址空间里的用户指针，先拷到内核栈上。
+ */
+#define ELF_PATH_MAX   128
+#define USER_STACK_MAX (8U * 1024 * 1024)
+
+int elf_exec(const char *path, uint32_t user_stack_top, elf_load_result_t *out) {
+    if (!path || !out) return -1;
+
+    char kpath[ELF_PATH_MAX];
+    size_t len = 0;
+    while (path[len] && len < ELF_PATH_MAX - 1) {
+        kpath[len] = path[len];
+        len++;
+    }
+    kpath[len] = '\0';
+
+    address_space_t *old = vmm_as_current();
+    address_space_t *as = vmm_as_create();
+    if (!as) {
+        kprintf("ELF: vmm_as_create failed\n");
+        return -1;
+    }
+    vmm_as_switch(as);
+
+    if (elf_load_from_file(kpath, out) < 0) {
+        goto fail;
+    }
+
+    if (vmm_vma_add(user_stack_top - USER_STACK_MAX, user_stack_top,
+                    VMM_RW | VMM_USER) < 0) {
+        goto fail;
+    }
+
+    if (old != vmm_as_kernel()) {
+        vmm_as_destroy(old);
+    }
+    user_heap_init();
+    return 0;
+
+fail:
+    vmm_as_switch(old);
+    vmm_as_destroy(as);
+    return -1;
+}
@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <libk/stdio.h>
+
+#include "kernel/ksyms.h"
+#include "kernel/elf.h"
+#include "kernel/pmm.h"
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+
+static const Elf32_Sym *symtab;
+static uint32_t         nsyms;
+static const char      *strtab;
+static uint32_t         strtab_size;
+
+// 非空、不回绕、整段在 physmap 里
+static bool ksyms_range_ok(uint32_t start, uint32_t size)
+{
+    return start && size && start + size > start && start + size <= PMM_DIRECT_LIMIT;
+}
+
+bool ksyms_boot_ranges(const multiboot_info_t *mbd, ksyms_range_t out[KSYMS_BOOT_RANGES])
+{
+    if (!(mbd->flags & MULTIBOOT_INFO_ELF_SHDR)) {
+        return false;
+    }
+    const multiboot_elf_section_header_table_t *es = &mbd->u.elf_sec;
+    if (!es->num || es->size != sizeof(Elf32_Shdr) ||
+        es->num > PMM_DIRECT_LIMIT / sizeof(Elf32_Shdr) ||
+        !ksyms_range_ok(es->addr, es->num * es->size)) {
+        return false;
+    }
+
+    const Elf32_Shdr *sh = (const Elf32_Shdr *)(es->addr + KERNEL_VIRT_OFFSET);
+    for (uint32_t i = 0; i < es->num; i++) {
+        if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= es->num) {
+            continue;
+        }
+        const Elf32_Shdr *str = &sh[sh[i].sh_link];
+        if (!ksyms_range_ok(sh[i].sh_addr, sh[i].sh_size) ||
+            !ksyms_range_ok(str->sh_addr, str->sh_size)) {
+            return false;
+        }
+        out[0] = (ksyms_range_t){ es->addr, es->addr + es->num * es->size };
+        out[1] = (ksyms_range_t){ sh[i].sh_addr, sh[i].sh_addr + sh[i].sh_size };
+        out[2] = (ksyms_range_t){ str->sh_addr, str->sh_addr + str->sh_size };
+        return true;
+    }
+    return false;
+}
+
+void ksyms_init(multiboot_info_t *mbd)
+{
+    mbd = (multiboot_info_t *)((uint32_t)mbd + KERNEL_VIRT_OFFSET);
+
+    ksyms_range_t r[KSYMS_BOOT_RANGES];
+    if (!ksyms_boot_ranges(mbd, r)) {
+        kprintf("ksyms: no usable symbol table from the bootloader ");
+        return;
+    }
+    // 这几页没被 PMM 留下来的话，里面可能已经是别的数据了
+    if (!pmm_boot_symbols_reserved()) {
+        kprintf("ksyms: symbol table not reserved by the PMM ");
+        return;
+    }
+
+    symtab      = (const Elf32_Sym *)(r[1].start + KERNEL_VIRT_OFFSET);
+    nsyms       = (r[1].end - r[1].start) / sizeof(Elf32_Sym);
+    strtab      = (const char *)(r[2].start + KERNEL_VIRT_OFFSET);
+    strtab_size = r[2].end - r[2].start;
+    kprintf("ksyms: %u symbols ", nsyms);
+}
+
+/*
+ * 线性扫一遍：只在打诊断信息时用，不值得为它排序建索引。
+ * 优先取包含 addr 的函数（st_value <= addr < st_value + st_size），
+ * 没有大小信息的（汇编里的标签）退而取 addr 之前最近的一个。
+ */
+const char *ksyms_lookup(uint32_t addr, uint32_t *offset)
+{
+    const Elf32_Sym *best = NULL;
+
+    for (uint32_t i = 0; i < nsyms; i++) {
+        const Elf32_Sym *s = &symtab[i];
+        if (ELF32_ST_TYPE(s->st_info) != STT_FUNC || s->st_value > addr ||
+            s->st_name >= strtab_size) {
+            continue;
+        }
+        if (s->st_size && addr < s->st_value + s->st_size) {
+            best = s;
+            break;
+        }
+        if (!s->st_size && (!best || s->st_value > best->st_value)) {
+            best = s;
+        }
+    }
+    if (!best) {
+        return NULL;
+    }
+    if (offset) {
+        *offset = addr - best->st_value;
+    }
+    return strtab + best->st_name;
+}
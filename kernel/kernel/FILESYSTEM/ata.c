@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <libk/stdio.h>
 #include "kernel/io.h"
 #include "kernel/pic.h"
@@ -20,7 +21,9 @@
 // ATA status bits
 #define ATA_SR_BSY   0x80
 #define ATA_SR_DRDY  0x40
+#define ATA_SR_DF    0x20
 #define ATA_SR_DRQ   0x08
+#define ATA_SR_ERR   0x01
 
 // ATA commands
 #define ATA_CMD_READ   0x20
@@ -35,9 +38,11 @@ static block_device_t *block_devices[MAX_BLOCK_DEVICES];
 static inline void ata_wait_busy(void) {
     while (inb(ATA_PRIMARY_STATUS) & ATA_SR_BSY) io_wait();
 }
-// Wait until DRQ=1
-static inline void ata_wait_drq(void) {
-    while (!(inb(ATA_PRIMARY_STATUS) & ATA_SR_DRQ)) io_wait();
+// Wait until DRQ=1; false if the drive reports an error instead
+static inline bool ata_wait_drq(void) {
+    uint8_t st;
+    while (!((st = inb(ATA_PRIMARY_STATUS)) & (ATA_SR_DRQ | ATA_SR_ERR | ATA_SR_DF))) io_wait();
+    return !(st & (ATA_SR_ERR | ATA_SR_DF));
 }
 // Wait until BSY=0 and DRDY=1
 static inline void ata_wait_ready(void) {
@@ -58,7 +63,7 @@ void ata_init(void) {
     ata_soft_reset();
 }
 
-// Read multiple sectors; returns number of sectors read
+// Read multiple sectors; returns number of sectors read (fewer on a drive error)
 uint32_t ata_read_sectors(uint32_t lba, uint8_t count, uint8_t *buffer) {
     uint32_t sectors = count ? count : 256;
     // Ensure device ready
@@ -73,9 +78,11 @@ uint32_t ata_read_sectors(uint32_t lba, uint8_t count, uint8_t *buffer) {
     // Issue read command
     outb(ATA_PRIMARY_COMMAND, ATA_CMD_READ);
     // For each sector, poll and transfer
-    for (uint8_t s = 0; s < sectors; s++) {
+    for (uint32_t s = 0; s < sectors; s++) {
         ata_wait_busy();
-        ata_wait_drq();
+        if (!ata_wait_drq()) {
+            return s;
+        }
         // Transfer 256 words => 512 bytes
         for (int i = 0; i < 256; i++) {
             uint16_t data;
@@ -87,9 +94,9 @@ uint32_t ata_read_sectors(uint32_t lba, uint8_t count, uint8_t *buffer) {
     return sectors;
 }
 
-// Write multiple sectors; returns number of sectors written
+// Write multiple sectors; returns number of sectors written (fewer on a drive error)
 uint32_t ata_write_sectors(uint32_t lba, uint8_t count, const uint8_t *buffer) {
-    uint8_t sectors = count ? count : 256;
+    uint32_t sectors = count ? count : 256;
     ata_wait_ready();
     outb(ATA_PRIMARY_DRIVE, 0xE0 | ((lba >> 24) & 0x0F)); io_wait();
     outb(ATA_PRIMARY_SECCOUNT, count);
@@ -97,15 +104,22 @@ uint32_t ata_write_sectors(uint32_t lba, uint8_t count, const uint8_t *buffer) {
     outb(ATA_PRIMARY_LBA1, (uint8_t)(lba >> 8));
     outb(ATA_PRIMARY_LBA2, (uint8_t)(lba >> 16));
     outb(ATA_PRIMARY_COMMAND, ATA_CMD_WRITE);
-    for (uint8_t s = 0; s < sectors; s++) {
+    for (uint32_t s = 0; s < sectors; s++) {
         ata_wait_busy();
-        ata_wait_drq();
+        if (!ata_wait_drq()) {
+            return s;
+        }
         for (int i = 0; i < 256; i++) {
             uint16_t data = buffer[0] | (buffer[1] << 8);
             __asm__ volatile ("outw %0, %w1" : : "a"(data), "Nd"(ATA_PRIMARY_DATA));
             buffer += 2;
         }
     }
+    // the last sector is only committed once BSY drops; ERR then means it failed
+    ata_wait_busy();
+    if (inb(ATA_PRIMARY_STATUS) & (ATA_SR_ERR | ATA_SR_DF)) {
+        return sectors - 1;
+    }
     return sectors;
 }
 
@@ -147,7 +161,7 @@ int register_block_device(block_device_t *dev) {
 }
 
 // IDENTIFY DEVICE for total blocks
-uint32_t ata_get_total_blocks() {
+uint32_t ata_get_total_blocks(void) {
     uint16_t id_data[256];
     ata_soft_reset();
     ata_wait_ready();
@@ -5,6 +5,7 @@
 #include "kernel/ata.h"
 #include "kernel/ext2.h"
 #include "kernel/kmalloc.h"
+#include "kernel/slab.h"
 #include "kernel/vmm.h"
 
 #define SECTOR_SIZE 512U
@@ -16,6 +17,8 @@
 static struct ext2_super_block sb;
 static struct ext2_group_desc *gbdt;
 static uint32_t sb_groups_count;
+// ext2_read_inode 读 inode 用的扇区缓冲：inode 可能跨扇区，大小按 inode_size 在 init 时定
+static kmem_cache_t *inode_buf_cache;
 
 static uint8_t read_sb(void) {
     static uint8_t buf[SECTOR_SIZE * SUPER_READ_SECS];
@@ -69,17 +72,16 @@ int ext2_read_inode(uint32_t inode_no, struct ext2_inode *inode_out)
                          / SECTOR_SIZE;
 
     /* 临时缓冲，读足扇区 */
-    uint32_t tmp_bytes = to_read * SECTOR_SIZE;
-    uint8_t *tmp = kmalloc(tmp_bytes);
+    uint8_t *tmp = kmem_cache_alloc(inode_buf_cache);
     if (!tmp) return -1;
     if (!ata_read_sectors(start_sec, to_read, tmp)) {
-        kfree(tmp);
+        kmem_cache_free(inode_buf_cache, tmp);
         return -1;
     }
 
     /* 拷贝 inode_size 字节 */
     kmemcpy(inode_out, tmp + off_in_sec, INODE_SIZE);
-    kfree(tmp);
+    kmem_cache_free(inode_buf_cache, tmp);
     return 0;
 }
 
@@ -125,7 +127,19 @@ int ext2_driver_init(void) {
     //     kprintf("Old revision (no extended fields)\n");
     // }
 
-    /* 4) 读 root inode 并打印它的大小 */
+    /* 4) inode 扇区缓冲：扇区内偏移最多 SECTOR_SIZE - 1，再加一个 inode */
+    {
+        uint32_t isz  = (sb.s_rev_level >= 1 ? sb.s_inode_size : 128);
+        uint32_t secs = (SECTOR_SIZE - 1 + isz + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        inode_buf_cache = kmem_cache_create("ext2_inode_buf", secs * SECTOR_SIZE,
+                                            SLAB_CACHE_LINE, 0, NULL);
+        if (!inode_buf_cache) {
+            kprintf("ext2_init: inode buffer cache failed\n");
+            return -1;
+        }
+    }
+
+    /* 5) 读 root inode 并打印它的大小 */
     {
         const uint32_t ROOT_INO = 2;
         uint32_t isz = (sb.s_rev_level >= 1 ? sb.s_inode_size : 128);
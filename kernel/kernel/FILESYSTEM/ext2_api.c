@@ -1,17 +1,23 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <libk/stdio.h>
 #include <libk/string.h>
 
 #include "kernel/ext2_api.h"
 #include "kernel/ext2.h"
 #include "kernel/ata.h"
-#include "kernel/kmalloc.h"
+#include "kernel/slab.h"
 #include "kernel/vmm.h"
 
 #define MAX_FD 16
+#define KERNEL_VIRT_OFFSET 0xC0000000U
 #define EXT2_ROOT_INO 2    /* ext2 根目录的 inode 编号 */
 
-static ext2_file_t file_table[MAX_FD];
+static ext2_file_t *file_table[MAX_FD];     // NULL 表示空闲槽
+
+// 打开文件的状态和块大小的临时缓冲都是定长的，各用一个 slab 缓存
+static kmem_cache_t *file_cache;
+static kmem_cache_t *block_cache;
 
 int ext2_init(void) {
     block_devices_init();;
@@ -20,6 +26,15 @@ int ext2_init(void) {
         return -1;
     }
     kmemset(file_table, 0, sizeof(file_table));
+
+    uint32_t block_size = 1024U << ext2_sb()->s_log_block_size;
+    file_cache  = kmem_cache_create("ext2_file", sizeof(ext2_file_t), 0,
+                                    SLAB_HWCACHE_ALIGN, NULL);
+    block_cache = kmem_cache_create("ext2_block", block_size, SLAB_CACHE_LINE, 0, NULL);
+    if (!file_cache || !block_cache) {
+        kprintf("EXT2: slab cache creation failed\n");
+        return -1;
+    }
     return 0;
 }
 
@@ -34,7 +49,7 @@ int ext2_read_dir(uint32_t dir_ino,
     // 2) 计算块大小，申请缓冲
     const struct ext2_super_block *sb = ext2_sb();
     uint32_t block_size = 1024U << sb->s_log_block_size;
-    uint8_t *buf = kmalloc(block_size);
+    uint8_t *buf = kmem_cache_alloc(block_cache);
     if (!buf) return -1;
 
     // 3) 遍历直接块
@@ -59,7 +74,7 @@ int ext2_read_dir(uint32_t dir_ino,
     }
 
     // 5) 清理并退出
-    kfree(buf);
+    kmem_cache_free(block_cache, buf);
     return 0;
 }
 
@@ -74,7 +89,7 @@ uint32_t ext2_lookup(uint32_t dir_ino, const char *name) {
 
     const struct ext2_super_block *sb = ext2_sb();
     uint32_t block_size = 1024U << sb->s_log_block_size;
-    uint8_t *buf = kmalloc(block_size);
+    uint8_t *buf = kmem_cache_alloc(block_cache);
     if (!buf) return 0;
 
     for (int i = 0; i < 12; i++) {
@@ -95,7 +110,7 @@ uint32_t ext2_lookup(uint32_t dir_ino, const char *name) {
 
                 if (kstrcmp(entry_name, name) == 0) {
                     uint32_t found = de->inode;
-                    kfree(buf);
+                    kmem_cache_free(block_cache, buf);
                     return found;
                 }
             }
@@ -104,7 +119,7 @@ uint32_t ext2_lookup(uint32_t dir_ino, const char *name) {
         }
     }
 
-    kfree(buf);
+    kmem_cache_free(block_cache, buf);
     return 0;
 }
 
@@ -133,22 +148,25 @@ int ext2_open(const char *path) {
 
     /* 分配一个 fd 槽 */
     for (int fd = 0; fd < MAX_FD; fd++) {
-        if (!file_table[fd].used) {
-            struct ext2_inode tmp_inode;
-            /* 先读 inode 原始数据 */
-            ext2_read_inode(ino, &tmp_inode);
-
-            file_table[fd].used  = 1;
-            file_table[fd].ino   = ino;
-            file_table[fd].pos   = 0;
+        if (!file_table[fd]) {
+            ext2_file_t *f = kmem_cache_alloc(file_cache);
+            if (!f)
+                return -1;
+
             /* 存下完整 inode 以备后续读取块时使用 */
-            file_table[fd].inode = tmp_inode;
+            if (ext2_read_inode(ino, &f->inode) < 0) {
+                kmem_cache_free(file_cache, f);
+                return -1;
+            }
+            f->ino = ino;
+            f->pos = 0;
 
             /* 合并 i_size_lo 和 i_size_hi */
-            uint64_t lo = tmp_inode.i_size_lo;
-            uint64_t hi = tmp_inode.i_size_hi;
-            file_table[fd].size = lo | (hi << 32);
+            uint64_t lo = f->inode.i_size_lo;
+            uint64_t hi = f->inode.i_size_hi;
+            f->size = lo | (hi << 32);
 
+            file_table[fd] = f;
             return fd;
         }
     }
@@ -156,66 +174,113 @@ int ext2_open(const char *path) {
     return -1;  /* 没有空闲槽 */
 }
 
+/*
+ * 文件内第 idx 个块对应的磁盘块号：支持 12 个直接块和一级间接块。
+ * 最近读过的间接块缓存在 ind_buf 里，顺序读时不用每块都再读一遍。
+ * 空洞或超出支持范围返回 0。
+ */
+static uint8_t *ind_buf;
+static uint32_t ind_blk;
+
+uint32_t ext2_bmap(const struct ext2_inode *inode, uint32_t idx) {
+    uint32_t block_size = 1024U << ext2_sb()->s_log_block_size;
+    uint32_t per_block  = block_size / sizeof(uint32_t);
+
+    if (idx < 12) {
+        return inode->i_block[idx];
+    }
+    idx -= 12;
+    if (idx >= per_block || !inode->i_block[12]) {
+        return 0;
+    }
+
+    if (!ind_buf) {
+        ind_buf = kmem_cache_alloc(block_cache);
+        if (!ind_buf) return 0;
+    }
+    if (ind_blk != inode->i_block[12]) {
+        if (ext2_read_block(inode->i_block[12], ind_buf) < 0) {
+            ind_blk = 0;
+            return 0;
+        }
+        ind_blk = inode->i_block[12];
+    }
+    return ((const uint32_t *)ind_buf)[idx];
+}
+
 /**
  * 从 fd 对应的文件当前位置读取最多 count 字节到 buf，
- * 返回实际读到的字节数（可能 < count），出错返回 -1
+ * 返回实际读到的字节数（可能 < count），出错返回 -1。
+ * buf 在内核半边时，整块对齐的部分直接读进 buf，只有头尾不满一块的部分才经过临时缓冲。
+ * 用户缓冲一律先读进临时缓冲，ATA 命令结束后再拷出去：用户页可能还没分配、
+ * 被换出或在 zram 里，PIO 传输中途缺页会在同一通道上再发一条命令（回收写交换、换入），
+ * 两边的传输都会错乱；只读映射的页还会让进程在驱动器等着送数据时被杀掉。
  */
 int ext2_read(int fd, void *buf, size_t count) {
-    if (fd < 0 || fd >= MAX_FD || !file_table[fd].used)
+    if (fd < 0 || fd >= MAX_FD || !file_table[fd])
         return -1;
 
-    ext2_file_t *f = &file_table[fd];
+    ext2_file_t *f = file_table[fd];
     size_t to_read   = count;
     size_t total_r   = 0;
     const struct ext2_inode *inode = &f->inode;
     const struct ext2_super_block *sb = ext2_sb();
     uint32_t block_size = 1024U << sb->s_log_block_size;
 
-    uint8_t *tmp = kmalloc(block_size);
-    if (!tmp) return -1;
+    uint8_t *tmp = NULL;
+    bool direct = (uintptr_t)buf >= KERNEL_VIRT_OFFSET;
 
     while (to_read > 0 && f->pos < f->size) {
         uint32_t blk_idx    = f->pos / block_size;
         uint32_t blk_offset = f->pos % block_size;
-        uint32_t blk;
-        /* 仅支持直接块 */
-        if (blk_idx < 12) {
-            blk = inode->i_block[blk_idx];
-        } else {
-            break;  /* 超过直接块，不再支持 */
-        }
+        uint32_t blk = ext2_bmap(inode, blk_idx);
         if (!blk) break;
 
-        if (ext2_read_block(blk, tmp) < 0) break;
-
         /* 计算本次拷贝长度 */
         size_t chunk = block_size - blk_offset;
         if (chunk > to_read)       chunk = to_read;
         if (chunk > f->size - f->pos) chunk = f->size - f->pos;
 
-        kmemcpy((uint8_t*)buf + total_r, tmp + blk_offset, chunk);
+        if (direct && chunk == block_size) {
+            if (ext2_read_block(blk, (uint8_t*)buf + total_r) < 0) break;
+        } else {
+            if (!tmp) {
+                tmp = kmem_cache_alloc(block_cache);
+                if (!tmp) break;
+            }
+            if (ext2_read_block(blk, tmp) < 0) break;
+            kmemcpy((uint8_t*)buf + total_r, tmp + blk_offset, chunk);
+        }
+
         f->pos      += chunk;
         total_r     += chunk;
         to_read     -= chunk;
     }
 
-    kfree(tmp);
+    kmem_cache_free(block_cache, tmp);
     return total_r;
 }
 
+const ext2_file_t *ext2_file(int fd) {
+    if (fd < 0 || fd >= MAX_FD || !file_table[fd])
+        return NULL;
+    return file_table[fd];
+}
+
 size_t ext2_filesize(int fd) {
-    if (fd < 0 || fd >= MAX_FD || !file_table[fd].used)
+    if (fd < 0 || fd >= MAX_FD || !file_table[fd])
         return 0;
-    return (size_t)file_table[fd].size;
+    return (size_t)file_table[fd]->size;
 }
 
 /**
  * 关闭 fd，使该槽可重用
  */
 int ext2_close(int fd) {
-    if (fd < 0 || fd >= MAX_FD || !file_table[fd].used)
+    if (fd < 0 || fd >= MAX_FD || !file_table[fd])
         return -1;
-    file_table[fd].used = 0;
+    kmem_cache_free(file_cache, file_table[fd]);
+    file_table[fd] = NULL;
     return 0;
 }
 
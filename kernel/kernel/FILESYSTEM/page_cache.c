@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <libk/string.h>
+#include <libk/stdio.h>
+
+#include "kernel/page_cache.h"
+#include "kernel/ext2_api.h"
+#include "kernel/kmalloc.h"
+#include "kernel/pmm.h"
+#include "kernel/vmm.h"
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+#define PAGE_SIZE          0x1000U
+
+struct file_cache {
+    uint32_t ino;
+    struct ext2_inode inode;
+    uint32_t size;                 // 文件大小（只支持 4 GiB 以内）
+    uint32_t nr_pages;
+    uint32_t refs;                 // 映射它的区域数（加上 mmap 还没登记完的那一份）
+    phys_addr_t *pages;            // 每页一个，0 表示还没读进来（或被回收了）
+    struct file_cache *next;
+};
+
+static file_cache_t *cache_list;
+
+file_cache_t *page_cache_file(int fd)
+{
+    const ext2_file_t *f = ext2_file(fd);
+    if (!f || (f->size >> 32)) {
+        return NULL;
+    }
+
+    for (file_cache_t *fc = cache_list; fc; fc = fc->next) {
+        if (fc->ino == f->ino) {
+            fc->refs++;
+            return fc;
+        }
+    }
+
+    // 一页至少要装下整数个块
+    uint32_t block_size = 1024U << ext2_sb()->s_log_block_size;
+    if (block_size > PAGE_SIZE) {
+        return NULL;
+    }
+
+    file_cache_t *fc = kmalloc(sizeof(*fc));
+    if (!fc) {
+        return NULL;
+    }
+    fc->ino      = f->ino;
+    fc->inode    = f->inode;
+    fc->size     = (uint32_t)f->size;
+    fc->nr_pages = (fc->size + PAGE_SIZE - 1) / PAGE_SIZE;
+    fc->refs     = 1;
+    fc->pages    = NULL;
+    if (fc->nr_pages) {
+        fc->pages = kmalloc(fc->nr_pages * sizeof(phys_addr_t));
+        if (!fc->pages) {
+            kfree(fc);
+            return NULL;
+        }
+        kmemset(fc->pages, 0, fc->nr_pages * sizeof(phys_addr_t));
+    }
+
+    fc->next   = cache_list;
+    cache_list = fc;
+    return fc;
+}
+
+/*
+ * 最后一个引用没了：缓存自己那份页引用还掉。还有进程映射着的页（区域都没了就不会有）
+ * 由映射自己的引用撑着，owner 清掉，免得指着释放了的缓存
+ */
+void page_cache_put(file_cache_t *fc)
+{
+    if (--fc->refs) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < fc->nr_pages; i++) {
+        if (fc->pages[i]) {
+            struct page *pg = pmm_page(fc->pages[i]);
+            pg->owner = NULL;
+            page_put(pg);
+        }
+    }
+
+    file_cache_t **link = &cache_list;
+    while (*link != fc) {
+        link = &(*link)->next;
+    }
+    *link = fc->next;
+
+    kfree(fc->pages);
+    kfree(fc);
+}
+
+static void page_cache_hold(void *cache)
+{
+    ((file_cache_t *)cache)->refs++;
+}
+
+static void page_cache_release(void *cache)
+{
+    page_cache_put(cache);
+}
+
+const vmm_page_source_t page_cache_source = {
+    .get_page = page_cache_get_page,
+    .hold     = page_cache_hold,
+    .release  = page_cache_release,
+};
+
+uint32_t page_cache_nr_pages(const file_cache_t *fc)
+{
+    return fc->nr_pages;
+}
+
+// 引用计数只剩缓存自己那一份的页没有映射，丢掉以后再缺页会重新读盘
+uint32_t page_cache_shrink(uint32_t nr_pages)
+{
+    uint32_t freed = 0;
+    for (file_cache_t *fc = cache_list; fc && freed < nr_pages; fc = fc->next) {
+        for (uint32_t i = 0; i < fc->nr_pages && freed < nr_pages; i++) {
+            if (!fc->pages[i]) {
+                continue;
+            }
+            struct page *pg = pmm_page(fc->pages[i]);
+            if (pg->refcount == 1) {
+                pg->owner = NULL;
+                page_put(pg);
+                fc->pages[i] = 0;
+                freed++;
+            }
+        }
+    }
+    return freed;
+}
+
+/*
+ * 把第 index 页读进一个清零的页：块直接读进页里，没有中间缓冲；
+ * 空洞和文件末尾之后的部分保持为零。
+ */
+static phys_addr_t page_cache_fill(file_cache_t *fc, uint32_t index)
+{
+    uint32_t block_size = 1024U << ext2_sb()->s_log_block_size;
+    uint32_t per_page   = PAGE_SIZE / block_size;
+
+    // 内存紧张时先回收（可能丢掉别的缓存页，这一页还是 0，不受影响）
+    phys_addr_t phys = vmm_alloc_user_frame(true);
+    if (!phys) {
+        return 0;
+    }
+    uint8_t *page = (uint8_t *)((uint32_t)phys + KERNEL_VIRT_OFFSET);
+
+    uint32_t pos = index * PAGE_SIZE;
+    for (uint32_t i = 0; i < per_page && pos < fc->size; i++, pos += block_size) {
+        uint32_t blk = ext2_bmap(&fc->inode, index * per_page + i);
+        if (!blk) {
+            continue;
+        }
+        if (ext2_read_block(blk, page + i * block_size) < 0) {
+            pmm_free_frame(phys);
+            return 0;
+        }
+        // 最后一块里文件末尾之后的字节不一定是零
+        if (fc->size - pos < block_size) {
+            kmemset(page + i * block_size + (fc->size - pos), 0,
+                    block_size - (fc->size - pos));
+        }
+    }
+
+    struct page *pg = pmm_page(phys);
+    pg->flags |= PG_FILE;
+    pg->owner  = fc;
+    return phys;
+}
+
+phys_addr_t page_cache_get_page(void *cache, uint32_t index)
+{
+    file_cache_t *fc = cache;
+    if (index >= fc->nr_pages) {
+        return 0;
+    }
+
+    // 缓存自己拿着一份引用，页一直留着给后面的映射用
+    if (!fc->pages[index]) {
+        fc->pages[index] = page_cache_fill(fc, index);
+        if (!fc->pages[index]) {
+            return 0;
+        }
+    }
+
+    page_get(pmm_page(fc->pages[index]));
+    return fc->pages[index];
+}
@@ -2,21 +2,14 @@
 #include <kernel/pic.h>
 #include <libk/stdio.h>
 #include <kernel/keyboard.h>
+#include <kernel/vmm.h>
+#include <kernel/registers.h>
+#include <kernel/process.h>
 
-extern void timer_isr();
+#define PF_USER_MODE (1 << 2)   /* 错误码 bit 2：出错时在用户态 */
+#define SIGSEGV      11
 
-typedef struct registers {
-    uint32_t edi;         // Last pushed by PUSHAD (lowest memory address)
-    uint32_t esi;
-    uint32_t ebp;
-    uint32_t esp;         // Original ESP (pushed by PUSHAD)
-    uint32_t ebx;
-    uint32_t edx;
-    uint32_t ecx;
-    uint32_t eax;         // First pushed by PUSHAD (highest memory address)
-    uint32_t int_num;      // Manually pushed interrupt number (e.g., 32 for IRQ0)
-    uint32_t dummy_error; // Manually pushed dummy error code (e.g., 0)
-} registers_t;
+extern void timer_isr();
 
 void interrupt_handler(registers_t *regs)
 {
@@ -27,6 +20,8 @@ void interrupt_handler(registers_t *regs)
         case 33:
             // Call the keyboard interrupt service routine if int_num is 32
             keyboard_isr();
+            // 有进程在空闲循环里等输入：这次中断直接回到它的 read
+            process_wake_input(regs);
             break;
         case 46:  // IRQ14: Primary ATA
             break;
@@ -40,24 +35,33 @@ void interrupt_handler(registers_t *regs)
     PIC_sendEOI((regs->int_num)-32); //Subtract 32 becuase of the offset
 }
 
-void page_fault_handler(uint32_t error_code) {
+void page_fault_handler(registers_t *regs) {
     uint32_t faulting_address;
     /* 读 CR2 寄存器，获得发生 Page Fault 的线性地址 */
     __asm__ volatile ("mov %%cr2, %0" : "=r"(faulting_address));
 
+    /* 堆、栈、.bss 这些按需分配的区域在这里补上页，返回后重新执行那条指令 */
+    if (vmm_handle_fault(faulting_address, regs->dummy_error) == 0) {
+        return;
+    }
+
     kprintf("Page Fault! EIP=0x%x, addr=0x%x, err=0x%x\n",
-           /* 你可以从栈里再取出返回 EIP，或者简化为： */ 0, 
+           regs->eip,
            faulting_address,
-           error_code);
+           regs->dummy_error);
 
-    /* 根据 error_code 位含义，决定是保护性错误还是不存在页。 */
     /* bit 0 = 0 (not-present) / 1 (protection fault) */
-    if (!(error_code & 0x1)) {
+    if (!(regs->dummy_error & 0x1)) {
         kprintf(" - Page not present\n");
     } else {
         kprintf(" - Protection violation\n");
     }
 
-    /* … 这里可以做缺页中断处理，或者直接死机 … */
-    for (;;);  /* 简单处理：停在这里 */
+    /* 用户态的缺页（包括换入时磁盘读错）：只结束这个进程，回到父进程 */
+    if ((regs->dummy_error & PF_USER_MODE) &&
+        process_exit(regs, 128 + SIGSEGV) == 0) {
+        return;
+    }
+
+    for (;;);  /* 没法恢复：停在这里 */
 }
@@ -32,25 +32,19 @@ _irq1:
 .global _isr14
 .align   4
 _isr14:
-    cli
-    pushl   %ebp
-    movl    %esp, %ebp
+    # The CPU already pushed the error code; add the vector number so the
+    # stack matches registers_t, then hand a pointer to the C handler.
+    pushl $14
+    pushal
+    cld
 
-    /* push the error code (at 8(%ebp)) */
-    pushl   8(%ebp)
-
-    /* save all general-purpose registers */
-    pusha
-
-    /* call the C handler */
+    movl %esp, %eax
+    pushl %eax
     call    page_fault_handler
+    addl $4, %esp
 
-    /* restore registers and drop the error code */
-    popa
-    addl    $4, %esp
-
-    leave
-    sti
+    popal
+    addl $8, %esp      # Drop the vector number and the CPU's error code
     iret
 
     
@@ -49,6 +49,10 @@ static void keyboard_buffer_push(char c) {
     key_write_index = next;
 }
 
+bool keyboard_has_input(void) {
+    return key_read_index != key_write_index;
+}
+
 int keyboard_getchar(void) {
     __asm__ volatile ("cli" ::: "memory");
 
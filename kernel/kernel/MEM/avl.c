@@ -0,0 +1,183 @@
+#include <stddef.h>
+#include "kernel/avl.h"
+
+static inline int avl_height(const avl_node_t *n)
+{
+    return n ? n->height : 0;
+}
+
+static inline void avl_update(avl_node_t *n)
+{
+    int l = avl_height(n->left);
+    int r = avl_height(n->right);
+    n->height = 1 + (l > r ? l : r);
+}
+
+// 把 parent 下面的 old 换成 new（parent 为空时换根）
+static void avl_replace_child(avl_tree_t *tree, avl_node_t *parent,
+                              avl_node_t *old, avl_node_t *new)
+{
+    if (!parent) {
+        tree->root = new;
+    } else if (parent->left == old) {
+        parent->left = new;
+    } else {
+        parent->right = new;
+    }
+    if (new) {
+        new->parent = parent;
+    }
+}
+
+static avl_node_t *avl_rotate_left(avl_tree_t *tree, avl_node_t *x)
+{
+    avl_node_t *y = x->right;
+
+    avl_replace_child(tree, x->parent, x, y);
+    x->right = y->left;
+    if (y->left) {
+        y->left->parent = x;
+    }
+    y->left   = x;
+    x->parent = y;
+
+    avl_update(x);
+    avl_update(y);
+    return y;
+}
+
+static avl_node_t *avl_rotate_right(avl_tree_t *tree, avl_node_t *x)
+{
+    avl_node_t *y = x->left;
+
+    avl_replace_child(tree, x->parent, x, y);
+    x->left = y->right;
+    if (y->right) {
+        y->right->parent = x;
+    }
+    y->right  = x;
+    x->parent = y;
+
+    avl_update(x);
+    avl_update(y);
+    return y;
+}
+
+// 从 n 一路往上重算高度，失衡的地方转一下
+static void avl_rebalance(avl_tree_t *tree, avl_node_t *n)
+{
+    while (n) {
+        avl_update(n);
+        int balance = avl_height(n->left) - avl_height(n->right);
+
+        if (balance > 1) {
+            if (avl_height(n->left->left) < avl_height(n->left->right)) {
+                avl_rotate_left(tree, n->left);
+            }
+            n = avl_rotate_right(tree, n);
+        } else if (balance < -1) {
+            if (avl_height(n->right->right) < avl_height(n->right->left)) {
+                avl_rotate_right(tree, n->right);
+            }
+            n = avl_rotate_left(tree, n);
+        }
+        n = n->parent;
+    }
+}
+
+void avl_insert(avl_tree_t *tree, avl_node_t *node, avl_cmp_t cmp)
+{
+    avl_node_t *parent = NULL;
+    avl_node_t **link = &tree->root;
+
+    while (*link) {
+        parent = *link;
+        link = cmp(node, parent) < 0 ? &parent->left : &parent->right;
+    }
+
+    node->left   = NULL;
+    node->right  = NULL;
+    node->parent = parent;
+    node->height = 1;
+    *link = node;
+
+    avl_rebalance(tree, parent);
+}
+
+void avl_remove(avl_tree_t *tree, avl_node_t *node)
+{
+    avl_node_t *start;
+
+    if (node->left && node->right) {
+        // 两个孩子：用后继 s 顶替 node 的位置
+        avl_node_t *s = node->right;
+        while (s->left) {
+            s = s->left;
+        }
+
+        if (s->parent == node) {
+            start = s;
+        } else {
+            start = s->parent;
+            avl_replace_child(tree, s->parent, s, s->right);
+            s->right = node->right;
+            s->right->parent = s;
+        }
+        avl_replace_child(tree, node->parent, node, s);
+        s->left = node->left;
+        s->left->parent = s;
+    } else {
+        start = node->parent;
+        avl_replace_child(tree, node->parent, node, node->left ? node->left : node->right);
+    }
+
+    avl_rebalance(tree, start);
+}
+
+avl_node_t *avl_first(const avl_tree_t *tree)
+{
+    avl_node_t *n = tree->root;
+    while (n && n->left) {
+        n = n->left;
+    }
+    return n;
+}
+
+avl_node_t *avl_last(const avl_tree_t *tree)
+{
+    avl_node_t *n = tree->root;
+    while (n && n->right) {
+        n = n->right;
+    }
+    return n;
+}
+
+avl_node_t *avl_next(const avl_node_t *node)
+{
+    if (node->right) {
+        node = node->right;
+        while (node->left) {
+            node = node->left;
+        }
+        return (avl_node_t *)node;
+    }
+    while (node->parent && node == node->parent->right) {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+avl_node_t *avl_prev(const avl_node_t *node)
+{
+    if (node->left) {
+        node = node->left;
+        while (node->right) {
+            node = node->right;
+        }
+        return (avl_node_t *)node;
+    }
+    while (node->parent && node == node->parent->left) {
+        node = node->parent;
+    }
+    return node->parent;
+}
@@ -6,6 +6,7 @@
 #include "kernel/paging.h"
 #include "kernel/pmm.h"
 #include "kernel/kha.h"
+#include "kernel/vmalloc.h"
 
 
 #define KERNEL_VIRT_OFFSET 0xC0000000UL
@@ -15,57 +16,73 @@
 #define VMM_RW       (1<<1)
 #define VMM_USER     (1<<2)
 
-// 从 linker script 导入的符号，标记内核镜像末尾
-extern uint8_t _kernel_end;
-
-// 当前的 heap break（下一个可用虚拟地址）
-static uintptr_t heap_brk;
-
-// 1) 初始化 heap_brk，取 _kernel_end 上对齐到下一页
+// 1) 内核镜像后面那一段已经被低端物理内存的直接映射占了，
+//    直接映射区的末尾之后是 vmalloc 区，地址由 vmalloc 分配、释放后回收
 void vmm_heap_init(void) {
-    uintptr_t start = (uintptr_t)&_kernel_end;
-    heap_brk = (start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    vmalloc_init();
 }
 
 // 2) 按页分配：连续 npages 页，每页物理分配 + 虚拟映射
-//    flags 对应 VMM_PRESENT|VMM_RW|VMM_USER 等
+//    flags 对应 VMM_PRESENT|VMM_RW|VMM_USER 等，带 VMALLOC_GUARD 时尾部留一页保护页
+//    （make VMGUARD=1 时每次分配都带）
 void *vmm_alloc_pages(size_t npages, uint32_t flags) {
-    // 对齐 heap_brk 到页边界
-    uintptr_t va = (heap_brk + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+#ifdef KERNEL_VMALLOC_GUARD
+    flags |= VMALLOC_GUARD;
+#endif
+    uintptr_t va = vmalloc_va_alloc(npages, flags & VMALLOC_GUARD);
+    if (!va) {
+        return NULL;
+    }
     uintptr_t base = va;
+    flags &= ~VMALLOC_GUARD;
+
+    // 先尝试从 buddy 拿一整块物理连续的内存，多出来的尾页马上还回去；
+    // 拿不到就退回逐页分配
+    uint32_t order = 0;
+    while (order <= PMM_MAX_ORDER && ((size_t)1 << order) < npages) {
+        order++;
+    }
+    phys_addr_t block = (order <= PMM_MAX_ORDER) ? pmm_alloc_pages(order) : 0;
+    if (block) {
+        for (size_t i = npages; i < ((size_t)1 << order); i++) {
+            pmm_free_frame(block + i * PAGE_SIZE);
+        }
+    }
 
     for (size_t i = 0; i < npages; i++) {
         // 分配物理页
-        uint32_t phys = pmm_alloc_frame();
+        phys_addr_t phys = block ? block + i * PAGE_SIZE : pmm_alloc_frame();
         if (!phys) {
             // 失败：回退已经映射的页
             for (size_t j = 0; j < i; j++) {
                 vmm_unmap_page(base + j * PAGE_SIZE, true);
             }
+            vmalloc_va_free(base);
             return NULL;
         }
         // 映射到虚拟地址
         if (vmm_map_page(va + i * PAGE_SIZE, phys, flags) < 0) {
-            // 失败：释放刚分配的物理页，并回退已映射页
-            pmm_free_frame(phys);
+            // 失败：释放还没映射的物理页，并回退已映射页
+            size_t last = block ? npages : i + 1;
+            for (size_t j = i; j < last; j++) {
+                pmm_free_frame(block ? block + j * PAGE_SIZE : phys);
+            }
             for (size_t j = 0; j < i; j++) {
                 vmm_unmap_page(base + j * PAGE_SIZE, true);
             }
+            vmalloc_va_free(base);
             return NULL;
         }
     }
 
-    // 成功，推进 heap_brk
-    heap_brk = va + npages * PAGE_SIZE;
     return (void*)base;
 }
 
-// 3) 释放一块连续的 npages：逐页 unmap + free
+// 3) 释放一块连续的 npages：批量 unmap，一次冲 TLB 后再释放物理页，地址还给 vmalloc
 void vmm_free_pages(void *ptr, size_t npages) {
     uintptr_t va = (uintptr_t)ptr;
-    for (size_t i = 0; i < npages; i++) {
-        vmm_unmap_page(va + i * PAGE_SIZE, true);
-    }
+    vmm_unmap_region(va, va + npages * PAGE_SIZE, true);
+    vmalloc_va_free(va);
 }
 
 // Test function for vmm_alloc_pages and vmm_free_pages
@@ -1,9 +1,12 @@
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <libk/stdio.h>
 #include "kernel/kha.h"
 #include "kernel/vmm.h"
+#include "kernel/io.h"
 #include "kernel/kmalloc.h"
+#include "kernel/ksyms.h"
 
 #define ALIGN_UP(x, a)   (((x) + (a) - 1) & ~((a) - 1))
 #define KMALLOC_ALIGN    8
@@ -13,94 +16,531 @@
 #define VMM_RW       (1<<1)
 #define VMM_USER     (1<<2)
 
+/*
+ * Two-level segregated fit (TLSF) heap.
+ *
+ * Free blocks are kept in FL_COUNT x SL_COUNT size classes: the first level
+ * is the power of two of the size, the second level splits each power of two
+ * into SL_COUNT linear steps. Two bitmaps record which classes are non-empty,
+ * so finding a fitting block is a couple of bsf instructions, not a list walk.
+ *
+ * Every block starts with a boundary tag (pointer to the physically previous
+ * block + size/flags). kfree() uses it to merge with free neighbours on both
+ * sides in O(1), so no two free blocks are ever adjacent.
+ *
+ * Each heap region from vmm_alloc_pages() ends in a zero-sized "used" sentinel
+ * block so that coalescing never runs past the region. A region that becomes
+ * entirely free again is handed back to the page allocator (except the last one).
+ *
+ * Requests of KMALLOC_LARGE_MIN bytes or more skip the heap: they get their
+ * own pages from vmm_alloc_pages() behind a small header marked BLOCK_LARGE,
+ * and kfree() unmaps them and returns the frames to the PMM right away.
+ */
+#define SL_LOG2          4
+#define SL_COUNT         (1U << SL_LOG2)
+#define ALIGN_LOG2       3
+#define FL_SHIFT         (SL_LOG2 + ALIGN_LOG2)          // sizes below 1 << FL_SHIFT share FL 0
+#define FL_MAX_LOG2      28
+#define FL_COUNT         (FL_MAX_LOG2 - FL_SHIFT + 2)
+#define SMALL_BLOCK      (1U << FL_SHIFT)
+
+#define KMALLOC_MAX_SIZE (1U << FL_MAX_LOG2)             // 256 MiB
+#define KMALLOC_GROW_MIN 4                               // grow the heap by at least this many pages
+#define KMALLOC_LARGE_MIN PAGE_SIZE                      // this big or larger: page-granular allocation
+
+#define BLOCK_FREE       0x1U
+#define BLOCK_PREV_FREE  0x2U
+#define BLOCK_LARGE      0x4U                            // kmem_large_t, not part of any heap region
+#define BLOCK_FLAGS      (BLOCK_FREE | BLOCK_PREV_FREE | BLOCK_LARGE)
+
 typedef struct kmem_block {
-    size_t size;               // size of this block *including* header
-    struct kmem_block *next;   // next free block
+    struct kmem_block *prev_phys;  // block just before this one in memory
+    size_t size;                   // payload bytes (excluding this header) | BLOCK_* flags
+    // the two links below overlay the payload and are only valid while free
+    struct kmem_block *next_free;
+    struct kmem_block *prev_free;
 } kmem_block_t;
 
-static kmem_block_t *free_list = NULL;
-// static uintptr_t    heap_end  = 0;  // tracks how far we’ve grown our heap
+#define BLOCK_HDR        offsetof(kmem_block_t, next_free)
+#define BLOCK_MIN        (sizeof(kmem_block_t) - BLOCK_HDR)   // room for the free links
+
+// header of a large allocation; `size` overlays kmem_block_t.size so kfree can tell them apart
+typedef struct {
+    uint32_t npages : 24;          // pages mapped, header included
+    uint32_t site   : 8;           // profiler callsite slot (KERNEL_KMALLOC_PROFILE only)
+    size_t   size;                 // requested bytes rounded to KMALLOC_ALIGN | BLOCK_LARGE
+} kmem_large_t;
+
+_Static_assert(sizeof(kmem_large_t) == BLOCK_HDR &&
+               offsetof(kmem_large_t, size) == offsetof(kmem_block_t, size),
+               "kmem_large_t must look like a block header");
+
+static uint32_t      heap_regions;     // regions currently backing the TLSF heap
+static uint32_t      heap_pages;
+static uint32_t      large_allocs;     // live large allocations
+static uint32_t      large_pages;
+
+static uint32_t      fl_bitmap;
+static uint32_t      sl_bitmap[FL_COUNT];
+static kmem_block_t *free_blocks[FL_COUNT][SL_COUNT];
+
+static inline uint32_t bsf(uint32_t x) {
+    uint32_t r;
+    __asm__ ("bsf %1, %0" : "=r"(r) : "rm"(x));
+    return r;
+}
+
+static inline uint32_t bsr(uint32_t x) {
+    uint32_t r;
+    __asm__ ("bsr %1, %0" : "=r"(r) : "rm"(x));
+    return r;
+}
+
+static inline size_t block_size(const kmem_block_t *b) {
+    return b->size & ~(size_t)BLOCK_FLAGS;
+}
+
+static inline void *block_payload(kmem_block_t *b) {
+    return (uint8_t *)b + BLOCK_HDR;
+}
+
+static inline kmem_block_t *block_from_payload(void *ptr) {
+    return (kmem_block_t *)((uint8_t *)ptr - BLOCK_HDR);
+}
+
+static inline kmem_block_t *block_next(kmem_block_t *b) {
+    return (kmem_block_t *)((uint8_t *)b + BLOCK_HDR + block_size(b));
+}
+
+// size class of a block of exactly `size` bytes (used when inserting)
+static inline void mapping_insert(size_t size, uint32_t *fl, uint32_t *sl) {
+    if (size < SMALL_BLOCK) {
+        *fl = 0;
+        *sl = (uint32_t)size / (SMALL_BLOCK / SL_COUNT);
+    } else {
+        uint32_t f = bsr((uint32_t)size);
+        *sl = ((uint32_t)size >> (f - SL_LOG2)) ^ SL_COUNT;
+        *fl = f - (FL_SHIFT - 1);
+    }
+}
+
+// round the request up to the next class boundary so any block in the
+// returned class (or above) is big enough (used when searching);
+// returns the rounded size
+static inline size_t mapping_search(size_t size, uint32_t *fl, uint32_t *sl) {
+    if (size >= SMALL_BLOCK) {
+        size_t round = (1U << (bsr((uint32_t)size) - SL_LOG2)) - 1;
+        size = (size + round) & ~round;
+    }
+    mapping_insert(size, fl, sl);
+    return size;
+}
+
+static void insert_free_block(kmem_block_t *b) {
+    uint32_t fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+
+    kmem_block_t *head = free_blocks[fl][sl];
+    b->prev_free = NULL;
+    b->next_free = head;
+    if (head) {
+        head->prev_free = b;
+    }
+    free_blocks[fl][sl] = b;
+    fl_bitmap     |= 1U << fl;
+    sl_bitmap[fl] |= 1U << sl;
+}
+
+static void remove_free_block(kmem_block_t *b) {
+    uint32_t fl, sl;
+    mapping_insert(block_size(b), &fl, &sl);
+
+    if (b->prev_free) {
+        b->prev_free->next_free = b->next_free;
+    } else {
+        free_blocks[fl][sl] = b->next_free;
+        if (!b->next_free) {
+            sl_bitmap[fl] &= ~(1U << sl);
+            if (!sl_bitmap[fl]) {
+                fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    if (b->next_free) {
+        b->next_free->prev_free = b->prev_free;
+    }
+}
 
-static kmem_block_t* expand_heap(size_t need) {
-    // round total request (need + header) up to pages
-    size_t total = ALIGN_UP(need + sizeof(kmem_block_t), PAGE_SIZE);
-    size_t npages = total / PAGE_SIZE;
+// first non-empty class at or above (fl, sl); NULL if the heap has nothing that big
+static kmem_block_t *find_suitable_block(uint32_t fl, uint32_t sl) {
+    if (fl >= FL_COUNT) {
+        return NULL;
+    }
+    uint32_t sl_map = sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        uint32_t fl_map = fl_bitmap & (~0U << (fl + 1));
+        if (!fl_map) {
+            return NULL;
+        }
+        fl     = bsf(fl_map);
+        sl_map = sl_bitmap[fl];
+    }
+    return free_blocks[fl][bsf(sl_map)];
+}
+
+// turn [v, v + bytes) into one free block followed by a used zero-size sentinel
+static kmem_block_t *expand_heap(size_t need) {
+    size_t npages = ALIGN_UP(need + 2 * BLOCK_HDR, PAGE_SIZE) / PAGE_SIZE;
+    if (npages < KMALLOC_GROW_MIN) {
+        npages = KMALLOC_GROW_MIN;
+    }
 
     void *v = vmm_alloc_pages(npages, VMM_PRESENT | VMM_RW);
     if (!v) return NULL;
+    heap_regions++;
+    heap_pages += npages;
+
+    kmem_block_t *blk = (kmem_block_t *)v;
+    blk->prev_phys = NULL;
+    blk->size      = npages * PAGE_SIZE - 2 * BLOCK_HDR;
 
-    // create one big free block covering that range
-    kmem_block_t *blk = (kmem_block_t*)v;
-    blk->size = npages * PAGE_SIZE;
-    blk->next = NULL;
+    kmem_block_t *sentinel = block_next(blk);
+    sentinel->prev_phys = blk;
+    sentinel->size      = 0;
     return blk;
 }
 
-void *kmalloc(size_t sz) {
-    if (sz == 0) return NULL;
-    // align
+static void *kmalloc_large(size_t sz) {
+    size_t npages = ALIGN_UP(sz + sizeof(kmem_large_t), PAGE_SIZE) / PAGE_SIZE;
+
+    kmem_large_t *hdr = vmm_alloc_pages(npages, VMM_PRESENT | VMM_RW);
+    if (!hdr) return NULL;
+    hdr->npages = npages;
+    hdr->site   = 0;
+    hdr->size   = ALIGN_UP(sz, KMALLOC_ALIGN) | BLOCK_LARGE;
+
+    large_allocs++;
+    large_pages += npages;
+    return hdr + 1;
+}
+
+static void kfree_large(kmem_large_t *hdr) {
+    large_allocs--;
+    large_pages -= hdr->npages;
+    vmm_free_pages(hdr, hdr->npages);
+}
+
+// a block from the TLSF heap itself; sz may be KMALLOC_LARGE_MIN or more
+static void *tlsf_alloc(size_t sz) {
     sz = ALIGN_UP(sz, KMALLOC_ALIGN);
+    if (sz < BLOCK_MIN) sz = BLOCK_MIN;
 
-    kmem_block_t **prev = &free_list;
-    kmem_block_t  *cur  = free_list;
-
-    // 1) search for a free block large enough
-    while (cur) {
-        if (cur->size >= sz + sizeof(kmem_block_t)) {
-            // found it — detach from free list
-            *prev = cur->next;
-
-            // optionally split if the remainder is big enough
-            size_t leftover = cur->size - (sz + sizeof(kmem_block_t));
-            if (leftover >= sizeof(kmem_block_t) + KMALLOC_ALIGN) {
-                kmem_block_t *rem = (kmem_block_t*)((uint8_t*)cur
-                                            + sizeof(kmem_block_t) + sz);
-                rem->size = leftover;
-                rem->next = free_list;
-                free_list = rem;
-
-                cur->size = sz + sizeof(kmem_block_t);
-            }
+    // 1) O(1) lookup in the segregated free lists
+    uint32_t fl, sl;
+    size_t rounded = mapping_search(sz, &fl, &sl);
+    kmem_block_t *blk = find_suitable_block(fl, sl);
+    if (blk) {
+        remove_free_block(blk);
+    } else {
+        // 2) nothing big enough — grow the heap; the new block is used directly.
+        //    Size it for the rounded class so that once freed it can serve
+        //    the same request again.
+        blk = expand_heap(rounded);
+        if (!blk) return NULL;
+    }
+
+    // 3) split off the tail if it can hold a free block of its own
+    kmem_block_t *next = block_next(blk);
+    size_t have = block_size(blk);
+    if (have - sz >= BLOCK_HDR + BLOCK_MIN) {
+        kmem_block_t *rem = (kmem_block_t *)((uint8_t *)blk + BLOCK_HDR + sz);
+        rem->prev_phys = blk;
+        rem->size      = (have - sz - BLOCK_HDR) | BLOCK_FREE;
+        next->prev_phys = rem;
+        next->size     |= BLOCK_PREV_FREE;
+        insert_free_block(rem);
+        have = sz;
+    } else {
+        next->size &= ~(size_t)BLOCK_PREV_FREE;
+    }
 
-            // return address just past the header
-            return (void*)(cur + 1);
+    // the previous block can't be free: free blocks are always merged
+    blk->size = have;
+    return block_payload(blk);
+}
+
+static void *heap_alloc(size_t sz) {
+    if (sz == 0 || sz > KMALLOC_MAX_SIZE) return NULL;
+    if (sz >= KMALLOC_LARGE_MIN) return kmalloc_large(sz);
+    return tlsf_alloc(sz);
+}
+
+
+static void heap_free(void *ptr) {
+    if (!ptr) return;
+    kmem_block_t *blk = block_from_payload(ptr);
+    if (blk->size & BLOCK_LARGE) {
+        kfree_large((kmem_large_t *)blk);
+        return;
+    }
+
+    // merge with the previous block if it is free
+    if (blk->size & BLOCK_PREV_FREE) {
+        kmem_block_t *prev = blk->prev_phys;
+        remove_free_block(prev);
+        prev->size += BLOCK_HDR + block_size(blk);      // keeps prev's flags
+        blk = prev;
+    }
+
+    // and with the next one
+    kmem_block_t *next = block_next(blk);
+    if (next->size & BLOCK_FREE) {
+        remove_free_block(next);
+        blk->size += BLOCK_HDR + block_size(next);
+        next = block_next(blk);
+    }
+
+    // the whole region is free again: give it back unless it is the last one
+    if (!blk->prev_phys && block_size(next) == 0 && heap_regions > 1) {
+        size_t npages = (block_size(blk) + 2 * BLOCK_HDR) / PAGE_SIZE;
+        heap_regions--;
+        heap_pages -= npages;
+        vmm_free_pages(blk, npages);
+        return;
+    }
+
+    blk->size      |= BLOCK_FREE;
+    next->prev_phys = blk;
+    next->size     |= BLOCK_PREV_FREE;
+    insert_free_block(blk);
+}
+#ifdef KERNEL_KMALLOC_PROFILE
+/*
+ * Heap profiler (make KPROF=1). Every heap allocation gets an 8-byte tag in
+ * front of it recording its callsite slot and requested size, so kfree() can
+ * charge the bytes back to the callsite that allocated them. Large
+ * allocations keep the slot in their kmem_large_t header instead, so a
+ * page-sized request maps the same number of pages as without the profiler;
+ * they are charged their size rounded to KMALLOC_ALIGN. Whether a request is
+ * large is decided on its own size, never on size + tag.
+ * Callsites are the return address of kmalloc() and live in a small
+ * open-addressed hash table; once it is full, new callsites are lumped into
+ * the last slot (caller 0).
+ */
+#define KPROF_SITES_LOG2 7
+#define KPROF_SITES      (1U << KPROF_SITES_LOG2)
+#define KPROF_OVERFLOW   KPROF_SITES
+
+// `site` overlays kmem_block_t.size and is stored shifted, so the BLOCK_*
+// bits stay clear and kfree() can tell a tag from a large header
+#define KPROF_TAG_SHIFT  3
+
+typedef struct {
+    uint32_t size;
+    uint32_t site;
+} kprof_tag_t;
+
+_Static_assert(sizeof(kprof_tag_t) % KMALLOC_ALIGN == 0, "tag must keep payload alignment");
+_Static_assert(offsetof(kprof_tag_t, site) == offsetof(kmem_block_t, size) &&
+               (1U << KPROF_TAG_SHIFT) > BLOCK_FLAGS, "tag must not look like a large header");
+_Static_assert(KPROF_OVERFLOW < 256, "slot must fit kmem_large_t.site");
+
+typedef struct {
+    uintptr_t caller;
+    uint32_t  live_bytes;
+    uint32_t  live_count;
+    uint32_t  peak_bytes;
+    uint32_t  allocs;
+    uint32_t  frees;
+} kprof_site_t;
+
+static kprof_site_t   kprof_sites[KPROF_SITES + 1];
+static kmalloc_prof_t kprof;
+
+static uint32_t kprof_site(uintptr_t caller) {
+    uint32_t h = ((uint32_t)caller * 2654435761U) >> (32 - KPROF_SITES_LOG2);
+    for (uint32_t i = 0; i < KPROF_SITES; i++) {
+        uint32_t k = (h + i) & (KPROF_SITES - 1);
+        if (kprof_sites[k].caller == caller) {
+            return k;
         }
-        prev = &cur->next;
-        cur  = cur->next;
+        if (!kprof_sites[k].caller) {
+            kprof_sites[k].caller = caller;
+            kprof.nr_sites++;
+            return k;
+        }
+    }
+    return KPROF_OVERFLOW;
+}
+
+static void *kprof_alloc(size_t sz, uintptr_t caller) {
+    bool large = sz >= KMALLOC_LARGE_MIN;
+    uint64_t t0 = rdtsc();
+    void *p = large ? heap_alloc(sz)
+            : sz    ? tlsf_alloc(sz + sizeof(kprof_tag_t))
+            : NULL;
+    uint32_t dt = (uint32_t)(rdtsc() - t0);
+
+    uint32_t b = dt < 64 ? 0 : bsr(dt) - 5;
+    kprof.lat_hist[b < KMALLOC_LAT_BUCKETS ? b : KMALLOC_LAT_BUCKETS - 1]++;
+    if (!p) {
+        kprof.fails++;
+        return NULL;
+    }
+
+    kprof_site_t *s = &kprof_sites[kprof_site(caller)];
+    if (large) {
+        kmem_large_t *hdr = (kmem_large_t *)block_from_payload(p);
+        hdr->site = s - kprof_sites;
+        sz = hdr->size & ~(size_t)BLOCK_FLAGS;
+    } else {
+        kprof_tag_t *tag = p;
+        tag->site = (s - kprof_sites) << KPROF_TAG_SHIFT;
+        tag->size = sz;
+        p = tag + 1;
+    }
+
+    s->live_bytes += sz;
+    s->live_count++;
+    s->allocs++;
+    if (s->live_bytes > s->peak_bytes) s->peak_bytes = s->live_bytes;
+
+    kprof.live_bytes += sz;
+    kprof.live_count++;
+    kprof.allocs++;
+    if (kprof.live_bytes > kprof.peak_bytes) kprof.peak_bytes = kprof.live_bytes;
+    return p;
+}
+
+static void kprof_free(void *ptr) {
+    if (!ptr) return;
+    kmem_block_t *blk = block_from_payload(ptr);
+    uint32_t slot, size;
+    if (blk->size & BLOCK_LARGE) {
+        kmem_large_t *hdr = (kmem_large_t *)blk;
+        slot = hdr->site;
+        size = hdr->size & ~(size_t)BLOCK_FLAGS;
+    } else {
+        kprof_tag_t *tag = (kprof_tag_t *)ptr - 1;
+        slot = tag->site >> KPROF_TAG_SHIFT;
+        size = tag->size;
+        ptr  = tag;
     }
 
-    // 2) no block found — grow the heap
-    kmem_block_t *blk = expand_heap(sz);
-    if (!blk) return NULL;
+    kprof_site_t *s = &kprof_sites[slot];
+    s->live_bytes -= size;
+    s->live_count--;
+    s->frees++;
+    kprof.live_bytes -= size;
+    kprof.live_count--;
+    kprof.frees++;
+    heap_free(ptr);
+}
+
+// callsites sorted by live bytes (biggest owners / leak suspects first), symbolized
+int kmalloc_profile(kmalloc_prof_t *summary, kmalloc_site_t *out, uint32_t max) {
+    uint32_t n = 0;
 
-    // if it’s bigger than we need, split as above:
-    size_t extra = blk->size - (sz + sizeof(kmem_block_t));
-    if (extra >= sizeof(kmem_block_t) + KMALLOC_ALIGN) {
-        kmem_block_t *rem = (kmem_block_t*)((uint8_t*)blk
-                                    + sizeof(kmem_block_t) + sz);
-        rem->size = extra;
-        rem->next = free_list;
-        free_list  = rem;
+    for (uint32_t k = 0; k <= KPROF_SITES; k++) {
+        const kprof_site_t *s = &kprof_sites[k];
+        if (!s->allocs) continue;
+
+        kmalloc_site_t e = {
+            .caller     = s->caller,
+            .live_bytes = s->live_bytes,
+            .live_count = s->live_count,
+            .peak_bytes = s->peak_bytes,
+            .allocs     = s->allocs,
+            .frees      = s->frees,
+        };
+        const char *name = s->caller ? ksyms_lookup(s->caller, &e.sym_off) : "(other)";
+        if (name) {
+            size_t len = kstrlen(name);
+            if (len >= KMALLOC_SYM_LEN) len = KMALLOC_SYM_LEN - 1;
+            kmemcpy(e.sym, name, len);
+            e.sym[len] = '\0';
+        }
 
-        blk->size = sz + sizeof(kmem_block_t);
+        // insertion sort, keeping only the top `max`
+        uint32_t j = n < max ? n++ : max;
+        while (j > 0 && out[j - 1].live_bytes < e.live_bytes) {
+            if (j < max) out[j] = out[j - 1];
+            j--;
+        }
+        if (j < max) out[j] = e;
     }
 
-    return (void*)(blk + 1);
+    *summary = kprof;
+    return (int)n;
 }
 
+void *kmalloc(size_t sz) {
+    return kprof_alloc(sz, (uintptr_t)__builtin_return_address(0));
+}
 
 void kfree(void *ptr) {
-    if (!ptr) return;
-    kmem_block_t *blk = ((kmem_block_t*)ptr) - 1;
+    kprof_free(ptr);
+}
+#else
+int kmalloc_profile(kmalloc_prof_t *summary, kmalloc_site_t *out, uint32_t max) {
+    (void)summary; (void)out; (void)max;
+    return -1;
+}
 
-    // simple: push to free_list head
-    blk->next   = free_list;
-    free_list   = blk;
+void *kmalloc(size_t sz) {
+    return heap_alloc(sz);
+}
 
-    // TODO: you can walk free_list and merge any two adjacent blocks
-    // if (blk + blk->size == blk->next) { /* coalesce */ }
+void kfree(void *ptr) {
+    heap_free(ptr);
 }
+#endif
+
+/*
+ * Churn microbenchmark: KMALLOC_BENCH_SLOTS slots randomly allocate
+ * (8 B - 8 KiB, so some are large allocations) or free, then everything
+ * is freed. Reports average and worst-case cycles per kmalloc/kfree (the
+ * worst kmalloc includes growing the heap) and the pages held by the heap
+ * at the peak and after the burst.
+ */
+#define KMALLOC_BENCH_SLOTS 256
+#define KMALLOC_BENCH_OPS   8192
 
+void kmalloc_bench(void) {
+    static void *slot[KMALLOC_BENCH_SLOTS];
+    uint32_t seed = 12345;
+    uint64_t total = 0;
+    uint32_t worst_alloc = 0, worst_free = 0;
+    uint32_t pages_before = heap_pages + large_pages, pages_peak = pages_before;
+
+    for (uint32_t i = 0; i < KMALLOC_BENCH_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t k = (seed >> 16) % KMALLOC_BENCH_SLOTS;
+        uint64_t t0 = rdtsc();
+        uint32_t dt;
+        if (slot[k]) {
+            kfree(slot[k]);
+            slot[k] = NULL;
+            dt = (uint32_t)(rdtsc() - t0);
+            if (dt > worst_free) worst_free = dt;
+        } else {
+            slot[k] = kmalloc(8 + ((seed >> 4) & 0x1FFF));
+            dt = (uint32_t)(rdtsc() - t0);
+            if (dt > worst_alloc) worst_alloc = dt;
+            if (heap_pages + large_pages > pages_peak) pages_peak = heap_pages + large_pages;
+        }
+        total += dt;
+    }
+    for (uint32_t k = 0; k < KMALLOC_BENCH_SLOTS; k++) {
+        kfree(slot[k]);
+        slot[k] = NULL;
+    }
+
+    kprintf("kmalloc bench: %u ops, %u cycles/op, worst kmalloc %u, worst kfree %u\n",
+            KMALLOC_BENCH_OPS, (uint32_t)(total / KMALLOC_BENCH_OPS), worst_alloc, worst_free);
+    kprintf("kmalloc bench: heap + large pages %u -> peak %u -> %u after freeing\n",
+            pages_before, pages_peak, heap_pages + large_pages);
+}
 
 // void kmalloc_test(void) {
 //     kprintf("=== kmalloc/kfree test start ===\n");
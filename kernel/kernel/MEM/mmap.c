@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "kernel/vmm.h"
+#include "kernel/mman.h"
+#include "kernel/ext2_api.h"
+#include "kernel/page_cache.h"
+
+#define PAGE_SIZE    0x1000U
+
+#define VMM_RW       (1 << 1)
+#define VMM_USER     (1 << 2)
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+
+// PROT_* 换成区域的页标志：能读就要 VMM_USER，i386 没有单独的执行权限
+static uint32_t prot_to_flags(uint32_t prot)
+{
+    uint32_t flags = 0;
+
+    if (prot & (PROT_READ | PROT_WRITE | PROT_EXEC)) {
+        flags |= VMM_USER;
+    }
+    if (prot & PROT_WRITE) {
+        flags |= VMM_RW;
+    }
+    return flags;
+}
+
+static bool user_range_ok(uintptr_t addr, uint32_t len)
+{
+    return !(addr & (PAGE_SIZE - 1)) && len != 0 &&
+           addr < KERNEL_VIRT_OFFSET && KERNEL_VIRT_OFFSET - addr >= len;
+}
+
+/*
+ * mmap：只在当前地址空间里登记一个区域，物理页在第一次访问时由缺页处理给出，
+ * munmap 时连区域带页一起还回去，所以大块的保留/释放互不影响，
+ * 不用挤在 sbrk 的一个 break 后面。
+ *   匿名私有映射：缺页时分配清零页
+ *   ext2 文件：只读、MAP_PRIVATE，页来自页缓存，所有映射同一文件的进程共享
+ */
+static int mmap_file_source(const mmap_args_t *args, file_cache_t **fc)
+{
+    if (args->prot & PROT_WRITE) {
+        return -1;
+    }
+    if (args->offset & (PAGE_SIZE - 1) || args->fd < EXT2_USER_FD_BASE) {
+        return -1;
+    }
+
+    *fc = page_cache_file(args->fd - EXT2_USER_FD_BASE);
+    if (!*fc) {
+        return -1;
+    }
+    // offset 要落在文件里；映射里超出文件末尾的页，访问时缺页处理会失败
+    if (args->offset / PAGE_SIZE >= page_cache_nr_pages(*fc)) {
+        page_cache_put(*fc);
+        return -1;
+    }
+    return 0;
+}
+
+void *sys_mmap(const mmap_args_t *args)
+{
+    if (!args) {
+        return MAP_FAILED;
+    }
+
+    uint32_t flags = args->flags;
+    if (!(flags & MAP_PRIVATE) || (flags & MAP_SHARED)) {
+        return MAP_FAILED;
+    }
+    if (args->len == 0 || args->len > KERNEL_VIRT_OFFSET) {
+        return MAP_FAILED;
+    }
+
+    uintptr_t addr = args->addr;
+    bool fixed = (flags & MAP_FIXED) != 0;
+    if (fixed && !user_range_ok(addr, args->len)) {
+        return MAP_FAILED;
+    }
+
+    int ret;
+    if (flags & MAP_ANONYMOUS) {
+        ret = vmm_vma_map(&addr, args->len, prot_to_flags(args->prot), fixed);
+    } else {
+        file_cache_t *fc;
+        if (mmap_file_source(args, &fc) < 0) {
+            return MAP_FAILED;
+        }
+        ret = vmm_vma_map_source(&addr, args->len, prot_to_flags(args->prot), fixed,
+                                 &page_cache_source, fc, args->offset / PAGE_SIZE);
+        // 映射成功后缓存的引用归区域，munmap/进程退出时还回去
+        if (ret < 0) {
+            page_cache_put(fc);
+        }
+    }
+
+    if (ret < 0) {
+        return MAP_FAILED;
+    }
+    return (void *)addr;
+}
+
+int sys_munmap(uintptr_t addr, uint32_t len)
+{
+    if (!user_range_ok(addr, len)) {
+        return -1;
+    }
+    return vmm_vma_unmap(addr, addr + len);
+}
+
+int sys_mprotect(uintptr_t addr, uint32_t len, uint32_t prot)
+{
+    if (!user_range_ok(addr, len)) {
+        return -1;
+    }
+    return vmm_vma_protect(addr, addr + len, prot_to_flags(prot));
+}
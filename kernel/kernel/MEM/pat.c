@@ -0,0 +1,168 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <libk/stdio.h>
+
+#include "kernel/pat.h"
+#include "kernel/vmm.h"
+#include "kernel/tty.h"
+#include "kernel/io.h"
+
+#define MSR_IA32_PAT 0x277
+#define CPUID_PAT    (1U << 16)     // CPUID.1:EDX
+#define CR4_PGE      (1 << 7)
+
+// IA32_PAT 里每项的内存类型编码
+#define PAT_UC       0x00
+#define PAT_WC       0x01
+#define PAT_WT       0x04
+#define PAT_WP       0x05
+#define PAT_WB       0x06
+#define PAT_UC_MINUS 0x07
+
+// 下标 0-7：WB WT UC- UC | WC WP UC- UC
+#define PAT_VALUE_LO (PAT_WB | (PAT_WT << 8) | (PAT_UC_MINUS << 16) | ((uint32_t)PAT_UC << 24))
+#define PAT_VALUE_HI (PAT_WC | (PAT_WP << 8) | (PAT_UC_MINUS << 16) | ((uint32_t)PAT_UC << 24))
+
+static bool pat_ok;
+
+void pat_init(void)
+{
+    uint32_t eax = 1, ebx, ecx, edx;
+    asm volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (!(edx & CPUID_PAT)) {
+        kprintf("PAT: not supported, write-combining falls back to UC-\n");
+        return;
+    }
+
+    // 改内存类型前后都把缓存写回，再冲一次 TLB（包括 Global 项）
+    asm volatile("wbinvd" ::: "memory");
+    asm volatile("wrmsr" :: "c"(MSR_IA32_PAT), "a"(PAT_VALUE_LO), "d"(PAT_VALUE_HI));
+    asm volatile("wbinvd" ::: "memory");
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    asm volatile("mov %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+    asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+
+    pat_ok = true;
+}
+
+bool pat_supported(void)
+{
+    return pat_ok;
+}
+
+uint32_t pat_index(uint32_t flags)
+{
+    uint32_t idx = (flags & VMM_CACHE_MASK) >> VMM_CACHE_SHIFT;
+    if (!pat_ok && idx >= 4) {
+        // 没有 PAT 时 PTE 的 PAT 位是保留位，只能用 PCD/PWT
+        return VMM_CACHE_UC_MINUS >> VMM_CACHE_SHIFT;
+    }
+    return idx;
+}
+
+/*
+ * 把 VGA 文本缓冲区依次改成 WB/WT/UC/WC，每种类型把当前屏幕内容原样整屏写
+ * PAT_BENCH_ROUNDS 遍（屏幕看起来不变），报告每屏平均 cycles。
+ * 带 lock 的指令会把 WC 缓冲排空，算在时间里。
+ * 再各量一次滚屏：老办法在显存里往上搬一行（要读显存），
+ * 现在的办法在普通内存的副本里搬、整屏写出去（tty.c）。测完恢复屏幕、改回 WC。
+ */
+#define PAT_BENCH_ROUNDS 64
+#define PAT_BENCH_WIDTH  80
+#define PAT_BENCH_CELLS  (PAT_BENCH_WIDTH * 25)
+
+static void pat_scroll_vram(volatile uint16_t *vram)
+{
+    for (uint32_t i = PAT_BENCH_WIDTH; i < PAT_BENCH_CELLS; i++) {
+        vram[i - PAT_BENCH_WIDTH] = vram[i];
+    }
+    for (uint32_t i = PAT_BENCH_CELLS - PAT_BENCH_WIDTH; i < PAT_BENCH_CELLS; i++) {
+        vram[i] = 0x0720;
+    }
+}
+
+static void pat_scroll_shadow(volatile uint16_t *vram, uint16_t *shadow)
+{
+    for (uint32_t i = PAT_BENCH_WIDTH; i < PAT_BENCH_CELLS; i++) {
+        shadow[i - PAT_BENCH_WIDTH] = shadow[i];
+    }
+    for (uint32_t i = PAT_BENCH_CELLS - PAT_BENCH_WIDTH; i < PAT_BENCH_CELLS; i++) {
+        shadow[i] = 0x0720;
+    }
+    for (uint32_t i = 0; i < PAT_BENCH_CELLS; i++) {
+        vram[i] = shadow[i];
+    }
+}
+
+void pat_bench(void)
+{
+    static const struct {
+        const char *name;
+        uint32_t cache;
+    } types[] = {
+        { "WB", VMM_CACHE_WB },
+        { "WT", VMM_CACHE_WT },
+        { "UC", VMM_CACHE_UC },
+        { "WC", VMM_CACHE_WC },
+    };
+    static uint16_t saved[PAT_BENCH_CELLS];
+    static uint16_t shadow[PAT_BENCH_CELLS];
+
+    volatile uint16_t *vram = (volatile uint16_t *)terminal_vram();
+    for (uint32_t i = 0; i < PAT_BENCH_CELLS; i++) {
+        saved[i] = vram[i];
+    }
+
+    uint32_t cycles[sizeof(types) / sizeof(types[0])];
+    uint32_t scroll_vram[sizeof(types) / sizeof(types[0])];
+    uint32_t scroll_shadow[sizeof(types) / sizeof(types[0])];
+    for (uint32_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        vmm_set_cache((uintptr_t)vram, 1, types[t].cache);
+
+        uint64_t t0 = rdtsc();
+        for (uint32_t r = 0; r < PAT_BENCH_ROUNDS; r++) {
+            for (uint32_t i = 0; i < PAT_BENCH_CELLS; i++) {
+                vram[i] = saved[i];
+            }
+            asm volatile("lock; addl $0, (%%esp)" ::: "memory");
+        }
+        cycles[t] = (uint32_t)(rdtsc() - t0) / PAT_BENCH_ROUNDS;
+
+        t0 = rdtsc();
+        for (uint32_t r = 0; r < PAT_BENCH_ROUNDS; r++) {
+            pat_scroll_vram(vram);
+            asm volatile("lock; addl $0, (%%esp)" ::: "memory");
+        }
+        scroll_vram[t] = (uint32_t)(rdtsc() - t0) / PAT_BENCH_ROUNDS;
+
+        for (uint32_t i = 0; i < PAT_BENCH_CELLS; i++) {
+            shadow[i] = saved[i];
+        }
+        t0 = rdtsc();
+        for (uint32_t r = 0; r < PAT_BENCH_ROUNDS; r++) {
+            pat_scroll_shadow(vram, shadow);
+            asm volatile("lock; addl $0, (%%esp)" ::: "memory");
+        }
+        scroll_shadow[t] = (uint32_t)(rdtsc() - t0) / PAT_BENCH_ROUNDS;
+    }
+
+    vmm_set_cache((uintptr_t)vram, 1, VMM_CACHE_WC);
+    for (uint32_t i = 0; i < PAT_BENCH_CELLS; i++) {
+        vram[i] = saved[i];
+    }
+
+    kprintf("console write %u B (cycles/screen, PAT %s):",
+            PAT_BENCH_CELLS * 2, pat_ok ? "on" : "off");
+    for (uint32_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        kprintf(" %s %u", types[t].name, cycles[t]);
+    }
+    kprintf("\n");
+
+    kprintf("console scroll (cycles, read VRAM / shadow copy):");
+    for (uint32_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        kprintf(" %s %u/%u", types[t].name, scroll_vram[t], scroll_shadow[t]);
+    }
+    kprintf("\n");
+}
@@ -3,32 +3,420 @@
 #include <stdint.h>
 #include <libk/stdio.h>
 #include <libk/string.h>
+#include "kernel/io.h"
+#include "kernel/vmm.h"
+#include "kernel/ksyms.h"
 
 #define ADDR_OFFSET 0xC0000000U
 
-// 4 GiB 物理空间，按 4 KiB 一页管理
+// 经典分页最多管理 4 GiB 物理空间，PAE 下 64 GiB（36 位物理地址），按 4 KiB 一页管理
 #define PAGE_SIZE       0x1000U                          // 4 KiB
+#ifdef KERNEL_PAE
+#define MAX_PHYS_MEM    (64ULL * 1024 * 1024 * 1024)      // 64 GiB
+#else
 #define MAX_PHYS_MEM    (4ULL * 1024 * 1024 * 1024)       // 4 GiB
-#define MAX_FRAMES      (MAX_PHYS_MEM / PAGE_SIZE)        // 1 048 576
-#define BITMAP_BYTES    (MAX_FRAMES / 8)                  // 131 072
+#endif
+#define MAX_FRAMES      (MAX_PHYS_MEM / PAGE_SIZE)        // 1 048 576 / 16 777 216
+#define LOW_MEM_END     0x00100000U                       // 1 MiB 以下留给 BIOS/GRUB
 
 // 把 physaddr 向下对齐到 PAGE_SIZE 的边界
 #define ALIGN_DOWN(a, sz)   ((a) & ~((sz) - 1))
+#define ALIGN_UP(a, sz)     (((a) + (sz) - 1) & ~((sz) - 1))
 
-static uint8_t pmm_bitmap[BITMAP_BYTES];
+/*
+ * 所有按页的元数据（位图、summary、buddy 各阶位图）都按 multiboot mmap 里
+ * 最高的可用地址来定大小，启动时从直接映射区的一块空闲内存里切出来，
+ * 不再是按 4 GiB 写死的 BSS 数组。
+ */
+static uint32_t pmm_nframes;          // 管理的页数，按 2^PMM_MAX_ORDER 向上对齐
+static uint32_t pmm_meta_phys;        // 元数据所在的物理区间
+static uint32_t pmm_meta_bytes;
+
+// 每页一个 struct page，下标就是页号
+static struct page *pmm_pages;
+
+static uint32_t *pmm_bitmap;
+
+// 两级索引：pmm_summary 的 bit w 置位 <=> pmm_bitmap[w] 里至少有一个空闲页。
+// 找空闲页时先在 summary 里 bsf 找到非满的字，再在那个字里 bsf，
+// 内存快用满时也只需要很少几次访存
+static uint32_t *pmm_summary;
+
+static inline uint32_t bsf(uint32_t x) {
+    uint32_t r;
+    __asm__ ("bsf %1, %0" : "=r"(r) : "rm"(x));
+    return r;
+}
+
+static inline uint32_t bsr(uint32_t x) {
+    uint32_t r;
+    __asm__ ("bsr %1, %0" : "=r"(r) : "rm"(x));
+    return r;
+}
+
+// meminfo 统计：分配/释放次数，pmm_alloc_frame 的 cycles 直方图
+static uint32_t pmm_alloc_count;
+static uint32_t pmm_free_count;
+static uint32_t pmm_alloc_lat_hist[PMM_LAT_BUCKETS];
 
 // 位图基本操作
-static inline void bitmap_set(uint32_t bit)   { pmm_bitmap[bit >> 3] |=  (1 << (bit & 7)); }
-static inline void bitmap_clear(uint32_t bit) { pmm_bitmap[bit >> 3] &= ~(1 << (bit & 7)); }
-static inline int  bitmap_test(uint32_t bit)  { return (pmm_bitmap[bit >> 3] >> (bit & 7)) & 1; }
+static inline void bitmap_set(uint32_t bit) {
+    uint32_t w = bit >> 5;
+    pmm_bitmap[w] |= 1U << (bit & 31);
+    if (pmm_bitmap[w] == 0xFFFFFFFFU) pmm_summary[w >> 5] &= ~(1U << (w & 31));
+}
+static inline void bitmap_clear(uint32_t bit) {
+    uint32_t w = bit >> 5;
+    pmm_bitmap[w] &= ~(1U << (bit & 31));
+    pmm_summary[w >> 5] |= 1U << (w & 31);
+}
+static inline int  bitmap_test(uint32_t bit)  { return (pmm_bitmap[bit >> 5] >> (bit & 31)) & 1; }
 
+static void fill_words(uint32_t *p, uint32_t value, uint32_t n) {
+    while (n--) *p++ = value;
+}
 
+// 把 [start, end) 的页描述符统一设成 refcount/flags，owner 清空
+static void pages_fill(uint32_t start, uint32_t end, uint16_t refcount, uint16_t flags) {
+    for (struct page *pg = &pmm_pages[start]; pg < &pmm_pages[end]; pg++) {
+        pg->refcount = refcount;
+        pg->flags    = flags;
+        pg->owner    = NULL;
+    }
+}
 
-void pmm_init(multiboot_info_t* mbd, uint32_t magic)
+// 把 [start, end) 整段标成空闲，中间的整字直接写 0
+static void bitmap_clear_range(uint32_t start, uint32_t end) {
+    while (start < end && (start & 31)) bitmap_clear(start++);
+    while (start + 32 <= end) {
+        uint32_t w = start >> 5;
+        pmm_bitmap[w] = 0;
+        pmm_summary[w >> 5] |= 1U << (w & 31);
+        start += 32;
+    }
+    while (start < end) bitmap_clear(start++);
+}
+
+// 把 [start, end) 整段标成占用，中间的整字直接写全 1
+static void bitmap_set_range(uint32_t start, uint32_t end) {
+    while (start < end && (start & 31)) bitmap_set(start++);
+    while (start + 32 <= end) {
+        uint32_t w = start >> 5;
+        pmm_bitmap[w] = 0xFFFFFFFFU;
+        pmm_summary[w >> 5] &= ~(1U << (w & 31));
+        start += 32;
+    }
+    while (start < end) bitmap_set(start++);
+}
+
+// 在 [start, end) 里找第一个空闲页，找不到返回 end
+static uint32_t bitmap_find_free(uint32_t start, uint32_t end) {
+    if (start >= end) return end;
+
+    // 起始字里 start 之前的位不算
+    uint32_t w = start >> 5;
+    uint32_t free_bits = ~pmm_bitmap[w] & (0xFFFFFFFFU << (start & 31));
+
+    // 用 summary 跳过整字都满的区域
+    while (!free_bits) {
+        w++;
+        if ((w << 5) >= end) return end;
+        uint32_t sw = w >> 5;
+        uint32_t sbits = pmm_summary[sw] & (0xFFFFFFFFU << (w & 31));
+        if (!sbits) {
+            w = ((sw + 1) << 5) - 1;
+            continue;
+        }
+        w = (sw << 5) | bsf(sbits);
+        free_bits = ~pmm_bitmap[w];
+    }
+
+    uint32_t i = (w << 5) | bsf(free_bits);
+    return i < end ? i : end;
+}
+
+// 在普通位图 map 的 [lo, hi) 里找第一个置位的位，找不到返回 hi
+static uint32_t bits_find_set(const uint32_t *map, uint32_t lo, uint32_t hi) {
+    while (lo < hi) {
+        uint32_t w = lo >> 5;
+        uint32_t bits = map[w] & (0xFFFFFFFFU << (lo & 31));
+        if (bits) {
+            uint32_t i = (w << 5) | bsf(bits);
+            return i < hi ? i : hi;
+        }
+        lo = (w + 1) << 5;
+    }
+    return hi;
+}
+
+/*
+ * 物理内存分区
+ *
+ *   DMA    [0, 16 MiB)                     ISA DMA 能访问，也在 boot 直接映射里
+ *   NORMAL [16 MiB, PMM_DIRECT_LIMIT)      在 physmap 里，内核可以直接用 phys + 0xC0000000 访问
+ *   HIGH   [PMM_DIRECT_LIMIT, MAX_PHYS_MEM) 只能通过页表映射后访问
+ *
+ * 每个区有自己的 buddy 空闲计数/搜索起点和单页 next-fit 起点。分配时先用
+ * 请求的区，不够再依次退到更低的区（HIGH -> NORMAL -> DMA），反过来不行。
+ * 区边界都按 4 MiB 对齐，buddy 块不会跨区。
+ */
+typedef struct {
+    const char *name;
+    uint32_t start, end;                  // 页号范围 [start, end)
+    uint32_t managed;                     // 区内可分配的页数（初始化时统计）
+    uint32_t last_alloc;                  // 单页分配的 next-fit 起点
+    uint32_t nr_free[PMM_MAX_ORDER + 1];  // 每阶空闲块个数
+    uint32_t hint[PMM_MAX_ORDER + 1];     // 每阶搜索起点（块下标）
+    uint32_t fallback;                    // 替更高的区分配出去的次数
+} pmm_zone_t;
+
+static pmm_zone_t zones[PMM_NR_ZONES] = {
+    [PMM_ZONE_DMA]    = { .name = "DMA" },
+    [PMM_ZONE_NORMAL] = { .name = "Normal" },
+    [PMM_ZONE_HIGH]   = { .name = "High" },
+};
+
+static inline uint32_t zone_of(uint32_t frame) {
+    if (frame >= zones[PMM_ZONE_HIGH].start)   return PMM_ZONE_HIGH;
+    if (frame >= zones[PMM_ZONE_NORMAL].start) return PMM_ZONE_NORMAL;
+    return PMM_ZONE_DMA;
+}
+
+static uint32_t zone_free_frames(const pmm_zone_t *z) {
+    uint32_t n = 0;
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+        n += z->nr_free[k] << k;
+    }
+    return n;
+}
+
+/*
+ * Buddy 分配器
+ *
+ * pmm_bitmap 仍然是“哪一页被占用”的唯一事实来源；buddy 层只记录空闲内存
+ * 是怎样被切成 2^k 对齐块的。第 k 阶的“空闲链表”用一张位图表示：
+ * bit i 置位 <=> 块 [i << k, (i + 1) << k) 整块空闲，且它的伙伴不是同阶空闲块
+ * （否则早就合并成 k+1 阶了）。这样元数据大小是固定的，不需要在空闲页里
+ * 放链表指针——高于 boot 映射的物理页内核目前根本访问不到。
+ *
+ * 空闲块个数和搜索起点 hint 按区分开记，hint 之前的块都不空闲。
+ * 分配时从 order 往上找第一个非空的阶，拆分时把上半块挂回低一阶。
+ */
+#define BUDDY_LEVEL_WORDS(k) (((pmm_nframes >> (k)) + 31) / 32)
+
+static uint32_t *buddy_bits;
+static uint32_t buddy_base[PMM_MAX_ORDER + 1];     // 每阶位图在 buddy_bits 里的起始字
+
+static inline uint32_t *buddy_word(uint32_t order, uint32_t idx) {
+    return &buddy_bits[buddy_base[order] + (idx >> 5)];
+}
+
+static inline int buddy_test(uint32_t order, uint32_t idx) {
+    return (*buddy_word(order, idx) >> (idx & 31)) & 1;
+}
+
+// 把块 (order, idx) 挂到所在区的空闲“链表”上
+static inline void buddy_push(uint32_t order, uint32_t idx) {
+    pmm_zone_t *z = &zones[zone_of(idx << order)];
+    *buddy_word(order, idx) |= 1U << (idx & 31);
+    z->nr_free[order]++;
+    if (idx < z->hint[order]) z->hint[order] = idx;
+}
+
+// 把块 (order, idx) 从空闲“链表”上摘下
+static inline void buddy_remove(uint32_t order, uint32_t idx) {
+    *buddy_word(order, idx) &= ~(1U << (idx & 31));
+    zones[zone_of(idx << order)].nr_free[order]--;
+}
+
+// 找区 z 里第 order 阶任意一个空闲块；调用前保证 z->nr_free[order] > 0
+static uint32_t buddy_find(pmm_zone_t *z, uint32_t order) {
+    uint32_t lo = z->start >> order;
+    uint32_t hi = z->end >> order;
+    if (z->hint[order] > lo) lo = z->hint[order];
+
+    uint32_t idx = bits_find_set(&buddy_bits[buddy_base[order]], lo, hi);
+    z->hint[order] = idx;
+    return idx;
+}
+
+// 释放块 (order, frame)：能和伙伴合并就一路向上合并
+static void buddy_release(uint32_t frame, uint32_t order) {
+    uint32_t idx = frame >> order;
+    while (order < PMM_MAX_ORDER && buddy_test(order, idx ^ 1)) {
+        buddy_remove(order, idx ^ 1);
+        idx >>= 1;
+        order++;
+    }
+    buddy_push(order, idx);
+}
+
+// 单页分配走的是位图扫描：选中的 frame 必须从它所在的空闲块里拆出来，
+// 拆剩下的兄弟块按阶挂回去
+static void buddy_claim_frame(uint32_t frame) {
+    uint32_t order = 0;
+    while (order <= PMM_MAX_ORDER && !buddy_test(order, frame >> order)) {
+        order++;
+    }
+    if (order > PMM_MAX_ORDER) {
+        kprintf("pmm: frame %u free in bitmap but not in buddy\n", frame);
+        return;
+    }
+    buddy_remove(order, frame >> order);
+    while (order > 0) {
+        order--;
+        buddy_push(order, (frame >> order) ^ 1);
+    }
+}
+
+// 把空闲区间 [start, end) 切成尽量大的对齐块放进 buddy
+static void buddy_add_range(uint32_t start, uint32_t end) {
+    while (start < end) {
+        uint32_t order = PMM_MAX_ORDER;
+        while (order > 0 &&
+               ((start & ((1U << order) - 1)) || start + (1U << order) > end)) {
+            order--;
+        }
+        buddy_push(order, start >> order);
+        start += 1U << order;
+    }
+}
+
+// 按位图当前状态重建所有阶的空闲块（buddy_bits 已经清零）
+static void buddy_init(void) {
+    uint32_t run_start = 0;
+    int in_run = 0;
+    for (uint32_t f = 0; f < pmm_nframes; f++) {
+        // 整字都被占用（不在空闲段里）或整字都空闲（在空闲段里）就直接跳过
+        if ((f & 31) == 0 &&
+            pmm_bitmap[f >> 5] == (in_run ? 0 : 0xFFFFFFFFU)) {
+            f += 31;
+            continue;
+        }
+        if (!bitmap_test(f)) {
+            if (!in_run) {
+                run_start = f;
+                in_run = 1;
+            }
+        } else if (in_run) {
+            buddy_add_range(run_start, f);
+            in_run = 0;
+        }
+    }
+    if (in_run) {
+        buddy_add_range(run_start, pmm_nframes);
+    }
+}
+
+static void pmm_zones_init(void) {
+    uint32_t dma_end    = PMM_DMA_LIMIT / PAGE_SIZE;
+    uint32_t direct_end = PMM_DIRECT_LIMIT / PAGE_SIZE;
+    if (direct_end < dma_end) direct_end = dma_end;
+
+    zones[PMM_ZONE_DMA].start    = 0;
+    zones[PMM_ZONE_DMA].end      = dma_end;
+    zones[PMM_ZONE_NORMAL].start = dma_end;
+    zones[PMM_ZONE_NORMAL].end   = direct_end;
+    zones[PMM_ZONE_HIGH].start   = direct_end;
+    zones[PMM_ZONE_HIGH].end     = pmm_nframes;
+
+    for (uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+        pmm_zone_t *z = &zones[i];
+        if (z->end > pmm_nframes) z->end = pmm_nframes;
+        if (z->start > z->end) z->start = z->end;
+        z->last_alloc = z->start;
+        z->fallback   = 0;
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+            z->nr_free[k] = 0;
+            z->hint[k]    = 0;
+        }
+    }
+}
+
+// 遍历 multiboot mmap：每条记录前面是它自己的 size 字段
+#define for_each_mmap_entry(map, mbd)                                              \
+    for (multiboot_memory_map_t *map =                                             \
+             (multiboot_memory_map_t *)(uintptr_t)((mbd)->mmap_addr + ADDR_OFFSET); \
+         (uintptr_t)map < (mbd)->mmap_addr + ADDR_OFFSET + (mbd)->mmap_length;     \
+         map = (multiboot_memory_map_t *)((uintptr_t)map + map->size + sizeof(map->size)))
+
+// 取一条可用记录在 MAX_PHYS_MEM 以下的页号范围 [*start, *end)，不可用返回 0
+static int mmap_usable_frames(const multiboot_memory_map_t *map,
+                              uint32_t *start, uint32_t *end) {
+    if (map->type != MULTIBOOT_MEMORY_AVAILABLE) {
+        return 0;
+    }
+    uint64_t base = map->addr_low | ((uint64_t)map->addr_high << 32);
+    uint64_t top  = base + map->len_low + ((uint64_t)map->len_high << 32);
+    if (top > MAX_PHYS_MEM) top = MAX_PHYS_MEM;
+    if (base >= top) {
+        return 0;
+    }
+
+    *start = (uint32_t)((base + PAGE_SIZE - 1) / PAGE_SIZE);
+    *end   = (uint32_t)(top / PAGE_SIZE);
+    return *start < *end;
+}
+
+// 启动早期不能动的物理区间
+typedef struct { uint32_t start, end; } phys_range_t;
+
+static int ranges_overlap(uint32_t start, uint32_t end,
+                          const phys_range_t *r, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (start < r[i].end && r[i].start < end) return 1;
+    }
+    return 0;
+}
+
+/*
+ * 在直接映射区 [1 MiB, PMM_DIRECT_LIMIT) 的可用内存里找 bytes 字节放元数据，
+ * 避开内核镜像和 GRUB 留下的 multiboot 结构。候选起点是每段可用内存的开头
+ * 和每个保留区间的结尾，返回物理地址，找不到返回 0。
+ */
+static uint32_t pmm_find_meta_region(multiboot_info_t *mbd, uint32_t bytes,
+                                     const phys_range_t *reserved, uint32_t nreserved) {
+    for_each_mmap_entry(map, mbd) {
+        uint32_t fs, fe;
+        if (!mmap_usable_frames(map, &fs, &fe) || fs >= PMM_DIRECT_LIMIT / PAGE_SIZE) {
+            continue;
+        }
+        uint32_t region_start = fs * PAGE_SIZE;
+        uint32_t region_end   = fe >= PMM_DIRECT_LIMIT / PAGE_SIZE ?
+                                PMM_DIRECT_LIMIT : fe * PAGE_SIZE;
+
+        for (uint32_t c = 0; c <= nreserved; c++) {
+            uint32_t cand = c == nreserved ? region_start
+                                           : ALIGN_UP(reserved[c].end, PAGE_SIZE);
+            if (cand < region_start) cand = region_start;
+            if (cand < LOW_MEM_END)  cand = LOW_MEM_END;
+            if (cand >= region_end || region_end - cand < bytes) {
+                continue;
+            }
+            if (!ranges_overlap(cand, cand + bytes, reserved, nreserved)) {
+                return cand;
+            }
+        }
+    }
+    return 0;
+}
+
+// pmm_init 看到的可用页区间，pmm_bench 拿来比较新旧两种元数据初始化
+#define INIT_BENCH_RANGES 16
+static struct { uint32_t start, end; } init_ranges[INIT_BENCH_RANGES];
+static uint32_t init_nranges;
+
+// 符号表那几页是不是留下来了（ksyms_init 据此决定能不能用）
+static bool pmm_syms_reserved;
+
+bool pmm_boot_symbols_reserved(void)
 {
+    return pmm_syms_reserved;
+}
 
-    // 1) 全图置 1
-    kmemset(pmm_bitmap, 0xFF, BITMAP_BYTES);
+void pmm_init(multiboot_info_t* mbd, uint32_t magic)
+{
+    uint64_t t0 = rdtsc();
 
     /* Make sure the magic number matches for memory mapping*/
     if(magic != MULTIBOOT_BOOTLOADER_MAGIC) {
@@ -36,6 +424,7 @@ void pmm_init(multiboot_info_t* mbd, uint32_t magic)
     }
 
     // Convert the physical pointer to its high-half virtual address:
+    uint32_t mbd_phys = (uint32_t)(uintptr_t)mbd;
     mbd = (multiboot_info_t*)((uintptr_t)mbd + ADDR_OFFSET);
 
 
@@ -44,74 +433,653 @@ void pmm_init(multiboot_info_t* mbd, uint32_t magic)
         kprintf("invalid memory map given by GRUB bootloader \n");
     }
 
-    // 2) 遍历 multiboot memory map，把 type=1 的页清空为“空闲”
-    uint32_t entries = mbd->mmap_length / sizeof(multiboot_memory_map_t);
-    multiboot_memory_map_t* map =
-        (multiboot_memory_map_t*)(uintptr_t)(mbd->mmap_addr + ADDR_OFFSET);
-
-    for(uint32_t i = 0; i < entries; i++) {
-        uint32_t base = map->addr_low;
-        uint32_t len  = map->len_low;
+    // 1) 找最高的可用页，决定要管理多少页
+    uint32_t max_frame = 0;
+    for_each_mmap_entry(map, mbd) {
+        uint32_t fs, fe;
+        if (mmap_usable_frames(map, &fs, &fe) && fe > max_frame) {
+            max_frame = fe;
+        }
+    }
+    pmm_nframes = ALIGN_UP(max_frame, 1U << PMM_MAX_ORDER);
 
-        if(map->type == MULTIBOOT_MEMORY_AVAILABLE) {
-            uint32_t start = (base + PAGE_SIZE - 1) / PAGE_SIZE;
-            uint32_t end   = (base + len) / PAGE_SIZE;
-            for(uint32_t f = start; f < end; f++) {
-                bitmap_clear(f);
-            }
+    // 把 PMM_DIRECT_LIMIT 以下的低端内存都映射进 physmap（整块的用大页），之后元数据、页表、
+    // 预清零页都可以放在这一整段里，用 phys + ADDR_OFFSET 访问
+    for_each_mmap_entry(map, mbd) {
+        uint32_t fs, fe;
+        if (mmap_usable_frames(map, &fs, &fe) && fs < PMM_DIRECT_LIMIT / PAGE_SIZE) {
+            if (fe > PMM_DIRECT_LIMIT / PAGE_SIZE) fe = PMM_DIRECT_LIMIT / PAGE_SIZE;
+            vmm_map_physmap(fs * PAGE_SIZE, fe * PAGE_SIZE);
         }
-        // advance to next entry: size 字段后面紧跟下一条
-        map = (multiboot_memory_map_t*)
-              ((uintptr_t)map + map->size + sizeof(map->size));
     }
 
-    // 3) 把内核自身占用的页又标回“占用”
     extern uint8_t _kernel_start, _kernel_end;
-    uint32_t phys_start = (uint32_t)&_kernel_start;
-    uint32_t phys_end   = (uint32_t)&_kernel_end   - ADDR_OFFSET;
-    uint32_t kstart = phys_start / PAGE_SIZE;
-    uint32_t kend   = (phys_end   + PAGE_SIZE - 1) / PAGE_SIZE;
-    // kprintf("Kernel phys start 0x%x, phys end 0x%x\n", phys_start, phys_end);
-    for(uint32_t f = kstart; f < kend; f++) {
-        bitmap_set(f);
+    phys_range_t reserved[6] = {
+        { (uint32_t)&_kernel_start, (uint32_t)&_kernel_end - ADDR_OFFSET },
+        { mbd_phys, mbd_phys + sizeof(multiboot_info_t) },
+        { mbd->mmap_addr, mbd->mmap_addr + mbd->mmap_length },
+    };
+    uint32_t nreserved = 3;
+    // GRUB 装进来的节头表和 .symtab/.strtab 留给 ksyms；三段都能留才留，否则都不留
+    ksyms_range_t syms[KSYMS_BOOT_RANGES];
+    uint32_t nsyms = 0;
+    if (ksyms_boot_ranges(mbd, syms)) {
+        for (nsyms = 0; nsyms < KSYMS_BOOT_RANGES; nsyms++) {
+            reserved[nreserved++] = (phys_range_t){ syms[nsyms].start, syms[nsyms].end };
+        }
+        pmm_syms_reserved = true;
     }
 
+    // 2) 算元数据大小：页描述符数组 + 位图 + summary + buddy 各阶位图
+    // 3) 在直接映射的空闲内存里切一块出来；放不下（PAE 下内存很大时）就少管一些高端内存
+    uint32_t page_words, bitmap_words, summary_words, buddy_words;
+    for (;;) {
+        page_words    = pmm_nframes * sizeof(struct page) / 4;
+        bitmap_words  = pmm_nframes / 32;
+        summary_words = (bitmap_words + 31) / 32;
+        buddy_words   = 0;
+        for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+            buddy_base[k] = buddy_words;
+            buddy_words += BUDDY_LEVEL_WORDS(k);
+        }
+        uint32_t meta_words = page_words + bitmap_words + summary_words + buddy_words;
+        pmm_meta_bytes = ALIGN_UP(meta_words * 4, PAGE_SIZE);
 
-    uint32_t zero_addr = pmm_alloc_frame();
-    if(zero_addr){
-        kprintf("Physical memory manager initilizatio failed \n");
+        pmm_meta_phys = pmm_find_meta_region(mbd, pmm_meta_bytes, reserved, nreserved);
+        if (pmm_meta_phys || pmm_nframes <= PMM_DIRECT_LIMIT / PAGE_SIZE) {
+            break;
+        }
+        pmm_nframes = ALIGN_DOWN(pmm_nframes - pmm_nframes / 8, 1U << PMM_MAX_ORDER);
+    }
+    if (!pmm_meta_phys) {
+        kprintf("pmm: no room for %u bytes of frame metadata\n", pmm_meta_bytes);
         asm volatile ("1: jmp 1b");
     }
-    
+    if (pmm_nframes < max_frame) {
+        kprintf("pmm: metadata only fits for %u MiB, ignoring memory above it\n",
+                pmm_nframes / 256);
+    }
+
+    uint32_t *meta = (uint32_t *)(pmm_meta_phys + ADDR_OFFSET);
+    pmm_pages   = (struct page *)meta;
+    pmm_bitmap  = meta + page_words;
+    pmm_summary = pmm_bitmap + bitmap_words;
+    buddy_bits  = pmm_summary + summary_words;
+
+    // 4) 位图全置 1（占用），summary 和 buddy 全清 0，都按字填
+    fill_words(pmm_bitmap, 0xFFFFFFFFU, bitmap_words);
+    fill_words(pmm_summary, 0, summary_words + buddy_words);
+    pmm_zones_init();
+
+    // 页描述符默认是“保留”：空洞、BIOS 区域这些永远不会被分配和释放
+    pages_fill(0, pmm_nframes, 1, PG_RESERVED);
+
+    // 5) 遍历 multiboot memory map，把 type=1 的页整段标成“空闲”
+    for_each_mmap_entry(map, mbd) {
+        uint32_t fs, fe;
+        if (mmap_usable_frames(map, &fs, &fe) && fs < pmm_nframes) {
+            if (fe > pmm_nframes) fe = pmm_nframes;
+            bitmap_clear_range(fs, fe);
+            pages_fill(fs, fe, 0, 0);
+            if (init_nranges < INIT_BENCH_RANGES) {
+                init_ranges[init_nranges].start = fs;
+                init_ranges[init_nranges].end   = fe;
+                init_nranges++;
+            }
+        }
+    }
+
+    // 6) 把内核自身和元数据占用的页又标回“占用”
+    uint32_t kstart = reserved[0].start / PAGE_SIZE;
+    uint32_t kend   = ALIGN_UP(reserved[0].end, PAGE_SIZE) / PAGE_SIZE;
+    uint32_t mstart = pmm_meta_phys / PAGE_SIZE;
+    uint32_t mend   = (pmm_meta_phys + pmm_meta_bytes) / PAGE_SIZE;
+    bitmap_set_range(kstart, kend);
+    pages_fill(kstart, kend, 1, PG_RESERVED);
+    bitmap_set_range(mstart, mend);
+    pages_fill(mstart, mend, 1, PG_RESERVED);
+    for (uint32_t i = nreserved - nsyms; i < nreserved; i++) {
+        uint32_t s = reserved[i].start / PAGE_SIZE;
+        uint32_t e = ALIGN_UP(reserved[i].end, PAGE_SIZE) / PAGE_SIZE;
+        bitmap_set_range(s, e);
+        pages_fill(s, e, 1, PG_RESERVED);
+    }
+
+    // 物理地址 0 用来表示“分配失败”，frame 0 永远不分配出去；
+    // 0xC03FF000 被 VGA 占了，物理页 0x3FF000 在直接映射里没有位置，也不能给内核用
+    bitmap_set(0);
+    pages_fill(0, 1, 1, PG_RESERVED);
+    bitmap_set(PMM_VGA_ALIAS_FRAME);
+    pages_fill(PMM_VGA_ALIAS_FRAME, PMM_VGA_ALIAS_FRAME + 1, 1, PG_RESERVED);
+
+    // 7) 用位图里剩下的空闲页建立 buddy 各阶空闲块
+    buddy_init();
+    for (uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+        zones[i].managed = zone_free_frames(&zones[i]);
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - t0);
+    kprintf("(%u MiB, %u KiB metadata, %u cycles) ",
+            pmm_nframes / 256, pmm_meta_bytes / 1024, cycles);
 }
 
-// 按页分配：先扫描 last_alloc 开始的空闲页
-static uint32_t last_alloc = 0;
-uint32_t pmm_alloc_frame(void)
+// 在区 z 的 [start, end) 里分一个单页：先找 last_alloc 之后的，找不到再从区头找
+static phys_addr_t zone_alloc_frame(pmm_zone_t *z, uint32_t end)
 {
-    for(uint32_t i = last_alloc; i < MAX_FRAMES; i++) {
-        if(!bitmap_test(i)) {
-            bitmap_set(i);
-            last_alloc = i + 1;
-            return i * PAGE_SIZE;
+    uint32_t from = z->last_alloc < z->start ? z->start : z->last_alloc;
+    uint32_t i = bitmap_find_free(from, end);
+    if(i >= end) {
+        i = bitmap_find_free(z->start, end);
+        if(i >= end) {
+            return 0;
         }
     }
-    for(uint32_t i = 0; i < last_alloc; i++) {
-        if(!bitmap_test(i)) {
-            bitmap_set(i);
-            last_alloc = i + 1;
-            return i * PAGE_SIZE;
+    bitmap_set(i);
+    buddy_claim_frame(i);
+    pages_fill(i, i + 1, 1, 0);
+    z->last_alloc = i + 1;
+    pmm_alloc_count++;
+    return (phys_addr_t)i * PAGE_SIZE;
+}
+
+// 在区 z 里分 2^order 个连续页
+static phys_addr_t zone_alloc_pages(pmm_zone_t *z, uint32_t order)
+{
+    uint32_t k = order;
+    while(k <= PMM_MAX_ORDER && z->nr_free[k] == 0) {
+        k++;
+    }
+    if(k > PMM_MAX_ORDER) {
+        return 0;  // 没有足够大的连续块
+    }
+
+    uint32_t idx = buddy_find(z, k);
+    buddy_remove(k, idx);
+
+    // 大块一分为二，上半块挂回低一阶，直到剩下需要的大小
+    while(k > order) {
+        k--;
+        idx <<= 1;
+        buddy_push(k, idx | 1);
+    }
+
+    uint32_t frame = idx << order;
+    for(uint32_t f = frame; f < frame + (1U << order); f++) {
+        bitmap_set(f);
+    }
+    pages_fill(frame, frame + (1U << order), 1, 0);
+    pmm_alloc_count++;
+    return (phys_addr_t)frame * PAGE_SIZE;
+}
+
+// 从 zone 开始往低区退让，分一个单页
+phys_addr_t pmm_alloc_frame_zone(uint32_t zone)
+{
+    if(zone >= PMM_NR_ZONES) {
+        return 0;
+    }
+    for(int i = (int)zone; i >= 0; i--) {
+        phys_addr_t addr = zone_alloc_frame(&zones[i], zones[i].end);
+        if(addr) {
+            if((uint32_t)i != zone) zones[i].fallback++;
+            return addr;
         }
     }
     return 0;  // 没有空闲页了
 }
 
+// 分一个物理地址低于 limit 的单页（limit 向下对齐到页）
+phys_addr_t pmm_alloc_frame_below(uint32_t limit)
+{
+    uint32_t limit_frame = limit / PAGE_SIZE;
+    for(int i = PMM_NR_ZONES - 1; i >= 0; i--) {
+        pmm_zone_t *z = &zones[i];
+        if(z->start >= limit_frame) {
+            continue;
+        }
+        uint32_t end = z->end < limit_frame ? z->end : limit_frame;
+        phys_addr_t addr = zone_alloc_frame(z, end);
+        if(addr) {
+            return addr;
+        }
+    }
+    return 0;
+}
+
+// 默认策略：优先高端内存，把能直接访问的低端内存留给内核和设备
+phys_addr_t pmm_alloc_frame(void)
+{
+    uint64_t t0 = rdtsc();
+    phys_addr_t addr = pmm_alloc_frame_zone(PMM_ZONE_HIGH);
+    uint32_t cycles = (uint32_t)(rdtsc() - t0);
+
+    // 桶 0: < 64 cycles，桶 i: [2^(i+5), 2^(i+6))，最后一桶收剩下的
+    uint32_t b = cycles < 64 ? 0 : bsr(cycles) - 5;
+    if(b >= PMM_LAT_BUCKETS) b = PMM_LAT_BUCKETS - 1;
+    pmm_alloc_lat_hist[b]++;
+    return addr;
+}
+
 // 释放物理页
-void pmm_free_frame(uint32_t physaddr)
+void pmm_free_frame(phys_addr_t physaddr)
 {
-    uint32_t frame = physaddr / PAGE_SIZE;
+    uint32_t frame = (uint32_t)(physaddr / PAGE_SIZE);
+    if(frame >= pmm_nframes || !bitmap_test(frame)) {
+        return;  // 越界或重复释放
+    }
+    if(pmm_pages[frame].flags & PG_RESERVED) {
+        kprintf("pmm_free_frame: frame %u is reserved\n", frame);
+        return;
+    }
+    // 还有别的使用者（共享映射、页缓存）：和 page_put 一样只还调用者这一份
+    if(pmm_pages[frame].refcount > 1) {
+        pmm_pages[frame].refcount--;
+        return;
+    }
     bitmap_clear(frame);
-    if(frame < last_alloc) last_alloc = frame;
+    buddy_release(frame, 0);
+    pages_fill(frame, frame + 1, 0, 0);
+    pmm_free_count++;
+
+    pmm_zone_t *z = &zones[zone_of(frame)];
+    if(frame < z->last_alloc) z->last_alloc = frame;
+}
+
+// 从 zone 开始往低区退让，分 2^order 个物理连续、按自身大小对齐的页
+phys_addr_t pmm_alloc_pages_zone(uint32_t order, uint32_t zone)
+{
+    if(order > PMM_MAX_ORDER || zone >= PMM_NR_ZONES) {
+        return 0;
+    }
+    for(int i = (int)zone; i >= 0; i--) {
+        phys_addr_t addr = zone_alloc_pages(&zones[i], order);
+        if(addr) {
+            if((uint32_t)i != zone) zones[i].fallback++;
+            return addr;
+        }
+    }
+    return 0;
+}
+
+// 分配 2^order 个物理连续、按自身大小对齐的页，返回首页物理地址，失败返回 0
+phys_addr_t pmm_alloc_pages(uint32_t order)
+{
+    return pmm_alloc_pages_zone(order, PMM_ZONE_HIGH);
+}
+
+// 释放 pmm_alloc_pages(order) 分到的块，和空闲的伙伴逐级合并
+void pmm_free_pages(phys_addr_t physaddr, uint32_t order)
+{
+    uint32_t frame = (uint32_t)(physaddr / PAGE_SIZE);
+    if(order > PMM_MAX_ORDER || (frame & ((1U << order) - 1)) ||
+       frame + (1U << order) > pmm_nframes) {
+        return;
+    }
+    // 整块一起还：有一页还被别人引用着就不能放回 buddy
+    for(uint32_t f = frame; f < frame + (1U << order); f++) {
+        if(!bitmap_test(f) || (pmm_pages[f].flags & PG_RESERVED)) {
+            kprintf("pmm_free_pages: frame %u already free or reserved\n", f);
+            return;
+        }
+        if(pmm_pages[f].refcount > 1) {
+            kprintf("pmm_free_pages: frame %u still has %u users\n", f, pmm_pages[f].refcount);
+            return;
+        }
+    }
+    for(uint32_t f = frame; f < frame + (1U << order); f++) {
+        bitmap_clear(f);
+    }
+    buddy_release(frame, order);
+    pages_fill(frame, frame + (1U << order), 0, 0);
+    pmm_free_count++;
+}
+
+// 物理地址 -> 页描述符，越界返回 NULL
+struct page *pmm_page(phys_addr_t physaddr)
+{
+    uint32_t frame = (uint32_t)(physaddr / PAGE_SIZE);
+    return frame < pmm_nframes ? &pmm_pages[frame] : NULL;
+}
+
+// 页描述符 -> 物理地址
+phys_addr_t pmm_page_phys(const struct page *pg)
+{
+    return (phys_addr_t)(uint32_t)(pg - pmm_pages) * PAGE_SIZE;
+}
+
+// 多一个使用者（共享映射、页缓存引用等）
+void page_get(struct page *pg)
+{
+    if(pg->flags & PG_RESERVED) {
+        return;
+    }
+    if(pg->refcount == 0xFFFF) {
+        kprintf("page_get: refcount overflow on frame %u\n", (uint32_t)(pg - pmm_pages));
+        return;
+    }
+    pg->refcount++;
+}
+
+// 少一个使用者，最后一个使用者放手时把页还给 PMM
+void page_put(struct page *pg)
+{
+    if(pg->flags & PG_RESERVED) {
+        return;
+    }
+    if(pg->refcount == 0) {
+        kprintf("page_put: frame %u is already free\n", (uint32_t)(pg - pmm_pages));
+        return;
+    }
+    if(--pg->refcount == 0) {
+        pmm_free_frame(pmm_page_phys(pg));
+    }
+}
+
+/*
+ * 预清零页池：空闲时（等键盘、hlt 之前）把页清零放进池子，
+ * pmm_alloc_zeroed_frame() 直接从池里拿，exec / sbrk / 新页表就不用在关键路径上清零。
+ * 池里的页都来自直接映射区（< PMM_DIRECT_LIMIT），可以用 phys + ADDR_OFFSET 访问。
+ */
+#define ZERO_POOL_SIZE 64
+
+static uint32_t zero_pool[ZERO_POOL_SIZE];
+static uint32_t zero_pool_count;
+static uint32_t zero_pool_hits;
+static uint32_t zero_pool_misses;
+
+// 按 4 字节清零，比逐字节的 kmemset 快得多
+void pmm_zero_range(phys_addr_t phys, uint32_t bytes)
+{
+    uint32_t *p = (uint32_t *)((uint32_t)phys + ADDR_OFFSET);
+    uint32_t n  = bytes / 4;
+    __asm__ volatile ("cld; rep stosl"
+                      : "+D"(p), "+c"(n)
+                      : "a"(0)
+                      : "memory");
+}
+
+static inline void zero_frame(uint32_t physaddr)
+{
+    pmm_zero_range(physaddr, PAGE_SIZE);
+}
+
+phys_addr_t pmm_alloc_zeroed_frame(void)
+{
+    if(zero_pool_count) {
+        zero_pool_hits++;
+        return zero_pool[--zero_pool_count];
+    }
+
+    zero_pool_misses++;
+    phys_addr_t phys = pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+    if(phys) {
+        zero_frame((uint32_t)phys);
+    }
+    return phys;
+}
+
+// 池子没满就清零补一页，返回 true；满了（或者没内存了）返回 false，调用者可以 hlt 了
+bool pmm_idle(void)
+{
+    if(zero_pool_count < ZERO_POOL_SIZE) {
+        uint32_t phys = (uint32_t)pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+        if(phys) {
+            zero_frame(phys);
+            zero_pool[zero_pool_count++] = phys;
+            return true;
+        }
+    }
+    return false;
+}
+
+void pmm_zero_pool_stats(pmm_zero_pool_stats_t *st)
+{
+    st->pooled = zero_pool_count;
+    st->hits   = zero_pool_hits;
+    st->misses = zero_pool_misses;
+}
+
+// 位图里最长的一段连续空闲页，整字全空/全满的直接跳过
+static uint32_t pmm_largest_free_run(void)
+{
+    uint32_t best = 0, run = 0;
+    for(uint32_t w = 0; w < pmm_nframes / 32; w++) {
+        uint32_t word = pmm_bitmap[w];
+        if(word == 0) {
+            run += 32;
+            continue;
+        }
+        if(word == 0xFFFFFFFFU) {
+            if(run > best) best = run;
+            run = 0;
+            continue;
+        }
+        for(uint32_t b = 0; b < 32; b++) {
+            if(word & (1U << b)) {
+                if(run > best) best = run;
+                run = 0;
+            } else {
+                run++;
+            }
+        }
+    }
+    return run > best ? run : best;
+}
+
+void pmm_get_stats(pmm_stats_t *st)
+{
+    uint32_t total = 0, free = 0;
+    for(uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+        total += zones[i].managed;
+        free  += zone_free_frames(&zones[i]);
+    }
+    st->total_frames     = total;
+    st->free_frames      = free;
+    st->used_frames      = total - free;
+    st->largest_free_run = pmm_largest_free_run();
+    // 0 = 空闲内存全连在一起，越接近 100 越碎
+    st->frag_score       = free ? 100 - st->largest_free_run * 100 / free : 0;
+    st->alloc_count      = pmm_alloc_count;
+    st->free_count       = pmm_free_count;
+    st->zero_pooled      = zero_pool_count;
+    st->zero_hits        = zero_pool_hits;
+    st->zero_misses      = zero_pool_misses;
+    for(uint32_t b = 0; b < PMM_LAT_BUCKETS; b++) {
+        st->alloc_lat_hist[b] = pmm_alloc_lat_hist[b];
+    }
+}
+
+// 打印每个区的范围和空闲情况
+void pmm_dump_zones(void)
+{
+    for(uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+        pmm_zone_t *z = &zones[i];
+        if(z->start >= z->end) {
+            continue;
+        }
+        kprintf("zone %s: %u-%u MiB managed %u free %u fallback %u\n",
+                z->name, z->start / 256, z->end / 256,
+                z->managed, zone_free_frames(z), z->fallback);
+    }
+}
+
+uint32_t pmm_free_frames(void) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+        n += zone_free_frames(&zones[i]);
+    }
+    return n;
+}
+
+/*
+ * pmm_init 元数据初始化，新旧两种做法在同一块临时内存上各跑一遍，用的是
+ * pmm_init 记下来的同一份可用区间：
+ *   旧：位图/summary/buddy 位图按 4 GiB 写死，整块 kmemset，可用页逐位清，
+ *       建 buddy 时逐页扫到 4 GiB（只跳过整字占用的）
+ *   新：按最高可用页定大小，整字填充、整字清，扫描时整字占用和整字空闲都跳过
+ * 两边都只扫描、不真的往 buddy 里挂块（那部分新旧一样）。
+ */
+#define INIT_BENCH_OLD_FRAMES  (1U << 20)                       // 4 GiB
+#define INIT_BENCH_OLD_BITMAP  (INIT_BENCH_OLD_FRAMES / 32)
+#define INIT_BENCH_OLD_SUMMARY (INIT_BENCH_OLD_BITMAP / 32)
+#define INIT_BENCH_OLD_BUDDY   (2 * INIT_BENCH_OLD_BITMAP)
+#define INIT_BENCH_ORDER       7                                // 512 KiB 临时内存
+
+// 建 buddy 时的扫描：数出空闲段，skip_free 时整字空闲也跳过
+static uint32_t init_bench_scan(const uint32_t *bm, uint32_t nframes, int skip_free)
+{
+    uint32_t runs = 0;
+    int in_run = 0;
+    for (uint32_t f = 0; f < nframes; f++) {
+        if ((f & 31) == 0 &&
+            (bm[f >> 5] == 0xFFFFFFFFU ? !in_run : (skip_free && in_run && bm[f >> 5] == 0))) {
+            f += 31;
+            continue;
+        }
+        int used = (bm[f >> 5] >> (f & 31)) & 1;
+        if (!used && !in_run) {
+            runs++;
+        }
+        in_run = !used;
+    }
+    return runs;
+}
+
+static uint32_t init_bench_old(uint32_t *scratch)
+{
+    uint32_t *bm  = scratch;
+    uint32_t *sum = bm + INIT_BENCH_OLD_BITMAP;
+    uint32_t *bud = sum + INIT_BENCH_OLD_SUMMARY;
+
+    uint64_t t0 = rdtsc();
+    kmemset(bm, 0xFF, INIT_BENCH_OLD_BITMAP * 4);
+    kmemset(sum, 0, INIT_BENCH_OLD_SUMMARY * 4);
+    kmemset(bud, 0, INIT_BENCH_OLD_BUDDY * 4);
+    for (uint32_t r = 0; r < init_nranges; r++) {
+        for (uint32_t f = init_ranges[r].start; f < init_ranges[r].end; f++) {
+            bm[f >> 5]  &= ~(1U << (f & 31));
+            sum[f >> 10] |= 1U << ((f >> 5) & 31);
+        }
+    }
+    init_bench_scan(bm, INIT_BENCH_OLD_FRAMES, 0);
+    return (uint32_t)(rdtsc() - t0);
+}
+
+// 用真正的 fill_words / bitmap_clear_range，位图指针临时指到临时内存上
+static uint32_t init_bench_new(uint32_t *scratch)
+{
+    uint32_t bitmap_words  = pmm_nframes / 32;
+    uint32_t summary_words = (bitmap_words + 31) / 32;
+    uint32_t buddy_words   = 0;
+    for (uint32_t k = 0; k <= PMM_MAX_ORDER; k++) {
+        buddy_words += BUDDY_LEVEL_WORDS(k);
+    }
+
+    uint32_t *saved_bitmap = pmm_bitmap, *saved_summary = pmm_summary;
+    pmm_bitmap  = scratch;
+    pmm_summary = scratch + bitmap_words;
+
+    uint64_t t0 = rdtsc();
+    fill_words(pmm_bitmap, 0xFFFFFFFFU, bitmap_words);
+    fill_words(pmm_summary, 0, summary_words + buddy_words);
+    for (uint32_t r = 0; r < init_nranges; r++) {
+        bitmap_clear_range(init_ranges[r].start, init_ranges[r].end);
+    }
+    init_bench_scan(pmm_bitmap, pmm_nframes, 1);
+    uint32_t cycles = (uint32_t)(rdtsc() - t0);
+
+    pmm_bitmap  = saved_bitmap;
+    pmm_summary = saved_summary;
+    return cycles;
+}
+
+static void pmm_init_bench(void)
+{
+    uint32_t old_words = INIT_BENCH_OLD_BITMAP + INIT_BENCH_OLD_SUMMARY + INIT_BENCH_OLD_BUDDY;
+    if (pmm_nframes > INIT_BENCH_OLD_FRAMES || old_words * 4 > (PAGE_SIZE << INIT_BENCH_ORDER)) {
+        kprintf("pmm init bench: skipped (%u MiB managed)\n", pmm_nframes / 256);
+        return;
+    }
+    phys_addr_t scratch = pmm_alloc_pages_zone(INIT_BENCH_ORDER, PMM_ZONE_NORMAL);
+    if (!scratch) {
+        kprintf("pmm init bench: no scratch memory\n");
+        return;
+    }
+    uint32_t *p = (uint32_t *)((uint32_t)scratch + ADDR_OFFSET);
+
+    uint32_t old_cycles = init_bench_old(p);
+    uint32_t new_cycles = init_bench_new(p);
+    pmm_free_pages(scratch, INIT_BENCH_ORDER);
+
+    uint32_t saved = old_cycles > new_cycles ? old_cycles - new_cycles : 0;
+    kprintf("pmm init bench: fixed 4 GiB/per-bit %u cycles (%u KiB), "
+            "sized %u MiB/word fills %u cycles (%u KiB), saved %u cycles (%u%%)\n",
+            old_cycles, old_words * 4 / 1024, pmm_nframes / 256, new_cycles,
+            pmm_meta_bytes / 1024, saved, old_cycles ? saved / (old_cycles / 100 + 1) : 0);
+}
+
+/*
+ * 启动时 microbenchmark：用 buddy 大块把内存填到不同占用率，
+ * 每一轮都把各区 last_alloc 拨回区头（也就是最坏的“绕回来从头扫”的情况）
+ * 连续分配 BENCH_BATCH 个单页再全部释放，报告平均 cycles。
+ */
+#define BENCH_BATCH      64
+#define BENCH_ROUNDS     16
+#define BENCH_MAX_BLOCKS 2048
+
+void pmm_bench(void) {
+    static phys_addr_t blocks[BENCH_MAX_BLOCKS];
+    static uint8_t  block_order[BENCH_MAX_BLOCKS];
+    static const uint32_t fill_pct[] = { 0, 50, 90, 95, 99 };
+    phys_addr_t frames[BENCH_BATCH];
+    uint32_t nblocks = 0;
+
+    pmm_init_bench();
+
+    uint32_t total = pmm_free_frames();
+    kprintf("pmm bench: %u free frames\n", total);
+
+    for (uint32_t l = 0; l < sizeof(fill_pct) / sizeof(fill_pct[0]); l++) {
+        // 填到目标占用率
+        uint32_t target = total - total / 100 * fill_pct[l];
+        for (int k = PMM_MAX_ORDER; k >= 0 && nblocks < BENCH_MAX_BLOCKS; k--) {
+            while (nblocks < BENCH_MAX_BLOCKS &&
+                   pmm_free_frames() >= target + (1U << k) + BENCH_BATCH) {
+                phys_addr_t a = pmm_alloc_pages((uint32_t)k);
+                if (!a) break;
+                blocks[nblocks] = a;
+                block_order[nblocks++] = (uint8_t)k;
+            }
+        }
+
+        uint64_t alloc_cycles = 0, free_cycles = 0;
+        for (uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+            for (uint32_t i = 0; i < PMM_NR_ZONES; i++) {
+                zones[i].last_alloc = zones[i].start;
+            }
+            uint64_t t0 = rdtsc();
+            for (uint32_t i = 0; i < BENCH_BATCH; i++) {
+                frames[i] = pmm_alloc_frame();
+            }
+            uint64_t t1 = rdtsc();
+            for (uint32_t i = 0; i < BENCH_BATCH; i++) {
+                pmm_free_frame(frames[i]);
+            }
+            uint64_t t2 = rdtsc();
+            alloc_cycles += t1 - t0;
+            free_cycles  += t2 - t1;
+        }
+
+        uint32_t ops = BENCH_BATCH * BENCH_ROUNDS;
+        kprintf("pmm bench: fill %u%% alloc %u cycles free %u cycles\n",
+                100 - pmm_free_frames() * 100 / total,
+                (uint32_t)(alloc_cycles / ops), (uint32_t)(free_cycles / ops));
+    }
+
+    while (nblocks > 0) {
+        nblocks--;
+        pmm_free_pages(blocks[nblocks], block_order[nblocks]);
+    }
 }
 
 // void pmm_test_frame(uint32_t physaddr)
@@ -0,0 +1,365 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <libk/stdio.h>
+
+#include "kernel/slab.h"
+#include "kernel/pmm.h"
+#include "kernel/kmalloc.h"
+#include "kernel/io.h"
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+#define PAGE_SIZE          0x1000U
+#define ALIGN_UP(x, a)     (((x) + (a) - 1) & ~((a) - 1))
+
+#define SLAB_MIN_ALIGN  8
+#define SLAB_MIN_OBJS   8       // 对象大的缓存加大 slab，直到一个 slab 至少放这么多
+#define SLAB_KEEP_EMPTY 1       // 每个缓存最多留几个空 slab，多的马上还给 PMM
+
+/*
+ * slab 描述符放在 slab 第一页的开头，slab 按 2^order 页对齐（buddy 块天然对齐，
+ * physmap 偏移 0xC0000000 也是 4 MiB 对齐），对象地址往下取整就是描述符。
+ */
+struct slab {
+    struct slab  *next;
+    struct slab  *prev;
+    kmem_cache_t *cache;
+    void         *free;         // 空闲对象链
+    uint32_t      inuse;
+};
+
+struct kmem_cache {
+    const char *name;
+    uint32_t obj_size;
+    uint32_t size;              // 对象间距
+    uint32_t align;
+    uint32_t free_off;          // 空闲链指针在对象里的偏移：有 ctor 时放在对象后面
+    void   (*ctor)(void *);
+
+    uint32_t order;
+    uint32_t per_slab;
+    uint32_t hdr_size;          // 描述符对齐后的大小，第一个对象不早于这里
+    uint32_t colour_off;        // 一档颜色的字节数
+    uint32_t colours;
+    uint32_t colour_next;
+
+    struct slab *partial;       // 优先从这里分
+    struct slab *full;
+    struct slab *empty;
+    uint32_t nr_empty;
+
+    uint32_t active_objs;
+    uint32_t total_objs;
+    uint32_t slabs;
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t grows;
+    uint32_t shrinks;
+    uint32_t fail_count;
+
+    kmem_cache_t *next;         // 所有缓存串成一条链（dump 用）
+};
+
+// 缓存描述符本身也从一个缓存里分；它自己是静态的
+static kmem_cache_t cache_cache;
+static kmem_cache_t *cache_list;
+
+static inline void **slab_free_ptr(const kmem_cache_t *c, void *obj)
+{
+    return (void **)((uint8_t *)obj + c->free_off);
+}
+
+static inline struct slab *slab_of(const kmem_cache_t *c, const void *obj)
+{
+    return (struct slab *)((uintptr_t)obj & ~((PAGE_SIZE << c->order) - 1));
+}
+
+static void slab_list_add(struct slab **head, struct slab *s)
+{
+    s->prev = NULL;
+    s->next = *head;
+    if (*head) {
+        (*head)->prev = s;
+    }
+    *head = s;
+}
+
+static void slab_list_del(struct slab **head, struct slab *s)
+{
+    if (s->prev) {
+        s->prev->next = s->next;
+    } else {
+        *head = s->next;
+    }
+    if (s->next) {
+        s->next->prev = s->prev;
+    }
+}
+
+// 算对象间距、slab 阶数、每个 slab 的对象数和着色档数；放不下返回 false
+static bool kmem_cache_setup(kmem_cache_t *c, const char *name, size_t size,
+                             size_t align, uint32_t flags, void (*ctor)(void *))
+{
+    if (!size || (align & (align - 1))) {
+        return false;
+    }
+    if (align < SLAB_MIN_ALIGN) {
+        align = SLAB_MIN_ALIGN;
+    }
+    if ((flags & SLAB_HWCACHE_ALIGN) && align < SLAB_CACHE_LINE) {
+        align = SLAB_CACHE_LINE;
+    }
+
+    *c = (kmem_cache_t){ 0 };
+    c->name     = name;
+    c->obj_size = size;
+    c->align    = align;
+    c->ctor     = ctor;
+
+    // 没有 ctor 时空闲对象的内容无所谓，链指针直接占对象开头，不多占空间
+    size_t span = size < sizeof(void *) ? sizeof(void *) : size;
+    if (ctor) {
+        c->free_off = ALIGN_UP(size, sizeof(void *));
+        span = c->free_off + sizeof(void *);
+    }
+    c->size     = ALIGN_UP(span, align);
+    c->hdr_size = ALIGN_UP(sizeof(struct slab), align);
+
+    uint32_t bytes = 0;
+    for (c->order = 0; c->order <= SLAB_MAX_ORDER; c->order++) {
+        bytes = PAGE_SIZE << c->order;
+        c->per_slab = bytes > c->hdr_size ? (bytes - c->hdr_size) / c->size : 0;
+        if (c->per_slab >= SLAB_MIN_OBJS || c->order == SLAB_MAX_ORDER) {
+            break;
+        }
+    }
+    if (!c->per_slab) {
+        return false;
+    }
+
+    uint32_t left = bytes - c->hdr_size - c->per_slab * c->size;
+    c->colour_off = align > SLAB_CACHE_LINE ? align : SLAB_CACHE_LINE;
+    c->colours    = left / c->colour_off + 1;
+    return true;
+}
+
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, size_t align,
+                                uint32_t flags, void (*ctor)(void *))
+{
+    if (!cache_cache.size) {
+        kmem_cache_setup(&cache_cache, "kmem_cache", sizeof(kmem_cache_t), 0,
+                         SLAB_HWCACHE_ALIGN, NULL);
+        cache_list = &cache_cache;
+    }
+
+    kmem_cache_t tmp;
+    if (!kmem_cache_setup(&tmp, name, size, align, flags, ctor)) {
+        return NULL;
+    }
+    kmem_cache_t *c = kmem_cache_alloc(&cache_cache);
+    if (!c) {
+        return NULL;
+    }
+    *c = tmp;
+    c->next    = cache_list;
+    cache_list = c;
+    return c;
+}
+
+// 分一个新 slab：对象按地址顺序串进空闲链，有 ctor 的逐个构造
+static struct slab *kmem_cache_grow(kmem_cache_t *c)
+{
+    phys_addr_t phys = pmm_alloc_pages_zone(c->order, PMM_ZONE_NORMAL);
+    if (!phys) {
+        return NULL;
+    }
+
+    struct slab *s = (struct slab *)((uint32_t)phys + KERNEL_VIRT_OFFSET);
+    s->cache = c;
+    s->inuse = 0;
+    s->free  = NULL;
+
+    uint8_t *base = (uint8_t *)s + c->hdr_size + c->colour_next * c->colour_off;
+    if (++c->colour_next == c->colours) {
+        c->colour_next = 0;
+    }
+    for (uint32_t i = c->per_slab; i-- > 0; ) {
+        void *obj = base + i * c->size;
+        if (c->ctor) {
+            c->ctor(obj);
+        }
+        *slab_free_ptr(c, obj) = s->free;
+        s->free = obj;
+    }
+
+    c->slabs++;
+    c->total_objs += c->per_slab;
+    c->grows++;
+    return s;
+}
+
+static void kmem_cache_release(kmem_cache_t *c, struct slab *s)
+{
+    c->slabs--;
+    c->total_objs -= c->per_slab;
+    c->shrinks++;
+    pmm_free_pages((uint32_t)s - KERNEL_VIRT_OFFSET, c->order);
+}
+
+void *kmem_cache_alloc(kmem_cache_t *c)
+{
+    struct slab *s = c->partial;
+    if (!s) {
+        if (c->empty) {
+            s = c->empty;
+            slab_list_del(&c->empty, s);
+            c->nr_empty--;
+        } else if (!(s = kmem_cache_grow(c))) {
+            c->fail_count++;
+            return NULL;
+        }
+        slab_list_add(&c->partial, s);
+    }
+
+    void *obj = s->free;
+    s->free = *slab_free_ptr(c, obj);
+    if (++s->inuse == c->per_slab) {
+        slab_list_del(&c->partial, s);
+        slab_list_add(&c->full, s);
+    }
+
+    c->active_objs++;
+    c->allocs++;
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t *c, void *obj)
+{
+    if (!obj) {
+        return;
+    }
+    struct slab *s = slab_of(c, obj);
+    if (s->cache != c) {
+        kprintf("slab: freeing 0x%x into %s, but it belongs elsewhere\n", obj, c->name);
+        return;
+    }
+
+    if (s->inuse == c->per_slab) {
+        slab_list_del(&c->full, s);
+        slab_list_add(&c->partial, s);
+    }
+    *slab_free_ptr(c, obj) = s->free;
+    s->free = obj;
+    c->active_objs--;
+    c->frees++;
+
+    if (--s->inuse == 0) {
+        slab_list_del(&c->partial, s);
+        if (c->nr_empty < SLAB_KEEP_EMPTY) {
+            slab_list_add(&c->empty, s);
+            c->nr_empty++;
+        } else {
+            kmem_cache_release(c, s);
+        }
+    }
+}
+
+int kmem_cache_destroy(kmem_cache_t *c)
+{
+    if (c->active_objs || c == &cache_cache) {
+        return -1;
+    }
+    while (c->empty) {
+        struct slab *s = c->empty;
+        slab_list_del(&c->empty, s);
+        kmem_cache_release(c, s);
+    }
+
+    for (kmem_cache_t **pp = &cache_list; *pp; pp = &(*pp)->next) {
+        if (*pp == c) {
+            *pp = c->next;
+            break;
+        }
+    }
+    kmem_cache_free(&cache_cache, c);
+    return 0;
+}
+
+void kmem_cache_get_stats(const kmem_cache_t *c, kmem_cache_stats_t *st)
+{
+    st->name        = c->name;
+    st->obj_size    = c->obj_size;
+    st->size        = c->size;
+    st->order       = c->order;
+    st->per_slab    = c->per_slab;
+    st->colours     = c->colours;
+    st->active_objs = c->active_objs;
+    st->total_objs  = c->total_objs;
+    st->slabs       = c->slabs;
+    st->allocs      = c->allocs;
+    st->frees       = c->frees;
+    st->grows       = c->grows;
+    st->shrinks     = c->shrinks;
+    st->fail_count  = c->fail_count;
+}
+
+void kmem_cache_dump(void)
+{
+    for (const kmem_cache_t *c = cache_list; c; c = c->next) {
+        kprintf("slab %s: %u/%u objs of %u (%u) bytes, %u slabs of %u pages, %u colours\n",
+                c->name, c->active_objs, c->total_objs, c->obj_size, c->size,
+                c->slabs, 1U << c->order, c->colours);
+        kprintf("slab %s: %u allocs %u frees, %u grows %u shrinks %u fails\n",
+                c->name, c->allocs, c->frees, c->grows, c->shrinks, c->fail_count);
+    }
+}
+
+/*
+ * 定长对象 microbenchmark：SLAB_BENCH_OBJS 个 SLAB_BENCH_SIZE 字节的对象
+ * 分配完再全部释放，反复 SLAB_BENCH_ROUNDS 轮，分别走 kmalloc/kfree 和 kmem_cache，
+ * 报告每次 alloc+free 的平均 cycles。
+ */
+#define SLAB_BENCH_OBJS   256
+#define SLAB_BENCH_SIZE   64
+#define SLAB_BENCH_ROUNDS 16
+
+void slab_bench(void)
+{
+    static void *objs[SLAB_BENCH_OBJS];
+    const uint32_t ops = SLAB_BENCH_OBJS * SLAB_BENCH_ROUNDS;
+
+    uint64_t t0 = rdtsc();
+    for (uint32_t r = 0; r < SLAB_BENCH_ROUNDS; r++) {
+        for (uint32_t i = 0; i < SLAB_BENCH_OBJS; i++) {
+            objs[i] = kmalloc(SLAB_BENCH_SIZE);
+        }
+        for (uint32_t i = 0; i < SLAB_BENCH_OBJS; i++) {
+            kfree(objs[i]);
+        }
+    }
+    uint32_t heap_cycles = (uint32_t)(rdtsc() - t0) / ops;
+
+    kmem_cache_t *c = kmem_cache_create("bench", SLAB_BENCH_SIZE, 0, SLAB_HWCACHE_ALIGN, NULL);
+    if (!c) {
+        kprintf("slab bench: kmem_cache_create failed\n");
+        return;
+    }
+    t0 = rdtsc();
+    for (uint32_t r = 0; r < SLAB_BENCH_ROUNDS; r++) {
+        for (uint32_t i = 0; i < SLAB_BENCH_OBJS; i++) {
+            objs[i] = kmem_cache_alloc(c);
+        }
+        for (uint32_t i = 0; i < SLAB_BENCH_OBJS; i++) {
+            kmem_cache_free(c, objs[i]);
+        }
+    }
+    uint32_t slab_cycles = (uint32_t)(rdtsc() - t0) / ops;
+
+    kmem_cache_stats_t st;
+    kmem_cache_get_stats(c, &st);
+    kmem_cache_destroy(c);
+
+    kprintf("slab bench: %u-byte objects, kmalloc/kfree %u cycles, kmem_cache %u cycles\n",
+            SLAB_BENCH_SIZE, heap_cycles, slab_cycles);
+    kprintf("slab bench: %u slabs grown, %u shrunk, %u per slab, %u colours\n",
+            st.grows, st.shrinks, st.per_slab, st.colours);
+}
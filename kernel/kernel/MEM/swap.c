@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <libk/stdio.h>
+
+#include "kernel/swap.h"
+#include "kernel/ata.h"
+#include "kernel/ext2.h"
+
+#define PAGE_SIZE        0x1000U
+#define SECTOR_SIZE      512U
+#define SECTORS_PER_PAGE (PAGE_SIZE / SECTOR_SIZE)
+
+static uint32_t swap_lba;                        // 交换区第一个扇区
+static uint32_t swap_nr_slots;                   // 0 表示没有交换区
+static uint16_t swap_map[SWAP_MAX_SLOTS];        // 每个槽的引用计数，0 = 空闲
+static uint32_t swap_hint;                       // 下一次从这里往后找空槽
+static swap_stats_t stats;
+
+void swap_init(void)
+{
+    const struct ext2_super_block *sb = ext2_sb();
+    uint32_t fs_end   = sb->s_blocks_count * ((1024U << sb->s_log_block_size) / SECTOR_SIZE);
+    uint32_t disk_end = ata_get_total_blocks();
+
+    if (disk_end <= fs_end || disk_end - fs_end < SECTORS_PER_PAGE) {
+        kprintf("swap: no space after ext2 (fs %u, disk %u sectors), swap disabled\n",
+                fs_end, disk_end);
+        return;
+    }
+
+    uint32_t slots = (disk_end - fs_end) / SECTORS_PER_PAGE;
+    if (slots > SWAP_MAX_SLOTS) {
+        slots = SWAP_MAX_SLOTS;
+    }
+    swap_lba      = fs_end;
+    swap_nr_slots = slots;
+    stats.total_slots = slots;
+    kprintf("swap: %u slots at LBA %u\n", slots, swap_lba);
+}
+
+bool swap_enabled(void)
+{
+    return swap_nr_slots != 0;
+}
+
+int swap_alloc(void)
+{
+    for (uint32_t i = 0; i < swap_nr_slots; i++) {
+        uint32_t slot = swap_hint + i;
+        if (slot >= swap_nr_slots) {
+            slot -= swap_nr_slots;
+        }
+        if (!swap_map[slot]) {
+            swap_map[slot] = 1;
+            swap_hint = slot + 1;
+            stats.used_slots++;
+            return (int)slot;
+        }
+    }
+    stats.alloc_fail++;
+    return -1;
+}
+
+void swap_dup(uint32_t slot)
+{
+    if (slot < swap_nr_slots && swap_map[slot]) {
+        swap_map[slot]++;
+    }
+}
+
+void swap_free(uint32_t slot)
+{
+    if (slot >= swap_nr_slots || !swap_map[slot]) {
+        return;
+    }
+    if (--swap_map[slot] == 0) {
+        stats.used_slots--;
+        if (slot < swap_hint) {
+            swap_hint = slot;
+        }
+    }
+}
+
+int swap_write_page(uint32_t slot, const void *page)
+{
+    if (ata_write_sectors(swap_lba + slot * SECTORS_PER_PAGE, SECTORS_PER_PAGE, page)
+            != SECTORS_PER_PAGE) {
+        stats.io_errors++;
+        return -1;
+    }
+    stats.swap_outs++;
+    return 0;
+}
+
+int swap_read_page(uint32_t slot, void *page)
+{
+    if (ata_read_sectors(swap_lba + slot * SECTORS_PER_PAGE, SECTORS_PER_PAGE, page)
+            != SECTORS_PER_PAGE) {
+        stats.io_errors++;
+        return -1;
+    }
+    stats.swap_ins++;
+    return 0;
+}
+
+void swap_account_scan(uint32_t scanned, uint32_t referenced)
+{
+    stats.scanned    += scanned;
+    stats.referenced += referenced;
+}
+
+void swap_get_stats(swap_stats_t *st)
+{
+    *st = stats;
+}
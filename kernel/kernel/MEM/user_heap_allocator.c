@@ -2,7 +2,6 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "kernel/vmm.h"
-#include "kernel/pmm.h"
 #include "kernel/user_heap.h"
 
 #define PAGE_SIZE       0x1000U
@@ -24,6 +23,21 @@ void user_heap_init(void) {
     user_heap_start = USER_HEAP_START;
     user_brk        = USER_HEAP_START;
     user_heap_limit = USER_HEAP_LIMIT;
+
+    // 堆是按需分配的区域，开始是空的，sbrk 只挪区域的结尾
+    vmm_vma_add(user_heap_start, user_brk, VMM_RW | VMM_USER);
+}
+
+void user_heap_save(user_heap_state_t *st) {
+    st->start = user_heap_start;
+    st->brk   = user_brk;
+    st->limit = user_heap_limit;
+}
+
+void user_heap_restore(const user_heap_state_t *st) {
+    user_heap_start = st->start;
+    user_brk        = st->brk;
+    user_heap_limit = st->limit;
 }
 
 void *sys_sbrk(intptr_t increment) {
@@ -54,52 +68,26 @@ void *sys_sbrk(intptr_t increment) {
         return (void *)-1;
     }
 
-    if (increment > 0) {
-        // old_brk -> new_brk 之间如果跨了页边界，需要补映射新页
-        //
-        // 例如：
-        // old_brk = 0x40000010
-        // new_brk = 0x40002020
-        //
-        // 需要映射：
-        // 0x40001000, 0x40002000 这些新进入范围的页
-        uintptr_t map_start = ALIGN_UP(old_brk, PAGE_SIZE);
-        uintptr_t map_end   = ALIGN_UP(new_brk, PAGE_SIZE);
-
-        for (uintptr_t va = map_start; va < map_end; va += PAGE_SIZE) {
-            uint32_t phys = pmm_alloc_frame();
-            if (!phys) {
-                // rollback 已映射的页
-                for (uintptr_t rva = map_start; rva < va; rva += PAGE_SIZE) {
-                    vmm_unmap_page(rva, true);
-                }
-                return (void *)-1;
-            }
-
-            if (vmm_map_page(va, phys, VMM_PRESENT | VMM_RW | VMM_USER) < 0) {
-                pmm_free_frame(phys);
-
-                // rollback 已映射的页
-                for (uintptr_t rva = map_start; rva < va; rva += PAGE_SIZE) {
-                    vmm_unmap_page(rva, true);
-                }
-                return (void *)-1;
-            }
-        }
-    } else {
+    // 只改区域范围，页在第一次访问时由缺页处理分配：
+    // 预留了一大块堆但只碰其中几页的程序，只为碰过的页付钱
+    // 整块对齐的 4 MiB 第一次缺页时直接给大页（vmm_fault_huge），分不到连续内存才退回 4 KiB
+    if (vmm_vma_resize(user_heap_start, new_brk) < 0) {
+        return (void *)-1;
+    }
+
+    if (increment < 0) {
         // shrink heap
         //
         // old_brk = 0x40002020
         // new_brk = 0x40000010
         //
-        // 需要释放已经不再覆盖的整页：
+        // 需要释放已经不再覆盖的整页（没碰过的页本来就没映射，直接跳过）：
         // [ALIGN_UP(new_brk), ALIGN_UP(old_brk))
         uintptr_t unmap_start = ALIGN_UP(new_brk, PAGE_SIZE);
         uintptr_t unmap_end   = ALIGN_UP(old_brk, PAGE_SIZE);
 
-        for (uintptr_t va = unmap_start; va < unmap_end; va += PAGE_SIZE) {
-            vmm_unmap_page(va, true);
-        }
+        // 批量 unmap：一次冲 TLB，清空的页表也还回去
+        vmm_unmap_region(unmap_start, unmap_end, true);
     }
 
     user_brk = new_brk;
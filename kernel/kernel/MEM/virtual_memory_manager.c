@@ -5,6 +5,14 @@
 #include "kernel/vmm.h"       // alloc_frame/free_frame，如果今后需要动态分配页表
 #include "kernel/paging.h"
 #include "kernel/pmm.h"
+#include "kernel/kmalloc.h"
+#include "kernel/slab.h"
+#include "kernel/io.h"
+#include "kernel/avl.h"
+#include "kernel/swap.h"
+#include "kernel/zram.h"
+#include "kernel/pat.h"
+#include "kernel/page_cache.h"
 
 
 #define KERNEL_VIRT_OFFSET 0xC0000000UL
@@ -14,57 +22,236 @@
 #define VMM_RW       (1<<1)
 #define VMM_USER     (1<<2)
 
+#define CR4_PGE      (1 << 7)
 
-// 汇编里 .bss 分配的那 4 KiB 页目录
-extern page_directory_t boot_page_directory;
+// 缺页错误码
+#define PF_PRESENT   (1 << 0)    // 0 = 页不存在，1 = 权限错误
+#define PF_WRITE     (1 << 1)
+
+// PTE 软件位（avail）
+#define PTE_COW      1           // 写时复制：fork 时把可写页改成只读并打上这个标记
+#define PTE_SWAP     2           // 换出到交换区：present = 0，frame 里放交换槽号
+#define PTE_ZRAM     4           // 压缩进 zram：present = 0，frame 里放 zram 句柄
+
+// 分不到页时一次换出多少页；空闲页低于水位时分配前先回收一批
+#define VMM_RECLAIM_BATCH 16
+#define VMM_FREE_LOW      256
+
+// 用户大页的阶：经典分页 4 MiB = 2^10 页，PAE 下 2 MiB = 2^9 页
+#define VMM_HUGE_ORDER    (PDE_SHIFT - 12)
+#define VMM_HUGE_PAGES    (1U << VMM_HUGE_ORDER)
 
-static page_table_t *ref_tables[PAGE_DIR_ENTRIES];
+// 不指定地址的 mmap 放在用户堆上限和用户栈区域之间
+#define VMM_MMAP_BASE 0x80000000U
+#define VMM_MMAP_TOP  0xBF000000U
 
-page_directory_t *current_pd;
+// 内核半边第一个 PDE 的下标
+#define KERNEL_PDE_START PDE_INDEX(KERNEL_VIRT_OFFSET)
+
+
+// 汇编里 .bss 分配的页目录（PAE 下是连续的 4 个页目录）
+extern page_directory_t boot_page_directory;
+#ifdef KERNEL_PAE
+extern page_dir_pointer_table_t boot_pdpt;
+#endif
+
+/*
+ * 地址空间：用户半边 [0, 3 GiB) 每个进程一份，内核半边 [3 GiB, 4 GiB) 大家共用。
+ *
+ * boot 页目录就是内核地址空间，也是内核半边 PDE 的唯一来源：
+ *   经典分页：每个进程页目录里有一份内核 PDE 的拷贝，内核新建页表/大页时
+ *             vmm_sync_kernel_pde() 把改动同步到所有地址空间。
+ *   PAE：     每个进程的 PDPT[3] 直接指向 boot 的第 4 个页目录，天然共享；
+ *             进程自己的 4 页块里前 3 页是用户页目录，第 4 页放 PDPT。
+ * 内核映射都带 Global 位（CR4.PGE），切换 CR3 时不会被冲出 TLB。
+ */
+typedef struct vm_area {
+    avl_node_t node;                // 按 start 排序
+    uintptr_t start;                // 页对齐，[start, end)
+    uintptr_t end;
+    uint32_t  flags;                // VMM_RW / VMM_USER；没有 VMM_USER 就是 PROT_NONE
+    const vmm_page_source_t *source; // 文件映射：缺页时从这里拿页；匿名区域为 NULL
+    void     *source_data;
+    uint32_t  pgoff;                // start 对应的文件页号
+} vm_area_t;
+
+struct address_space {
+    page_directory_t *pd;           // 页目录（内核虚拟地址）
+    uint32_t cr3;                   // 装进 CR3 的物理地址（PAE 下是 PDPT）
+    struct address_space *next;     // 所有进程地址空间串成一条链
+    avl_tree_t vmas;                // 用户半边的所有区域（ELF 段、堆、栈、mmap）
+    uint32_t nr_vmas;
+    vmstat_t stat;                  // 这个地址空间自己的 vmstat
+};
+
+#define kernel_pd (&boot_page_directory)
+
+static address_space_t kernel_as;
+static address_space_t *current_as = &kernel_as;
+static address_space_t *as_list;
+
+// 回收用的 clock 指针：下一次从 clock_as 的 clock_va 接着扫
+static address_space_t *clock_as;
+static uintptr_t clock_va;
+
+static vmm_huge_stats_t huge_stats;
+
+// mmap/munmap/mprotect 频繁地建、拆、切 VMA，用 slab 缓存
+static kmem_cache_t *vma_cache;
+
+/*
+ * vmstat：每个计数同时记到全局和对应的地址空间上，内核半边的记到 kernel_as。
+ * pt_pages 是现值，其余都是累计值。
+ */
+static vmstat_t vmstat_global;
+
+#define VMSTAT_ADD(as, field, n) do {     \
+        vmstat_global.field += (n);       \
+        (as)->stat.field    += (n);       \
+    } while (0)
+#define VMSTAT_SUB(as, field, n) do {     \
+        vmstat_global.field -= (n);       \
+        (as)->stat.field    -= (n);       \
+    } while (0)
+
+static inline address_space_t *vmm_as_of(uintptr_t vaddr) {
+    return vaddr >= KERNEL_VIRT_OFFSET ? &kernel_as : current_as;
+}
 
 static inline void vmm_invlpg(uintptr_t vaddr) {
     asm volatile("invlpg (%0)" : : "r"(vaddr) : "memory");
+    VMSTAT_ADD(vmm_as_of(vaddr), invlpg, 1);
+}
+
+// 整体冲 TLB：global 时拨一下 CR4.PGE 连内核 Global 项一起冲，否则重载 CR3 只冲用户项
+static void vmm_flush_tlb(bool global) {
+    if (global) {
+        uint32_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile("mov %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+        asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+    } else {
+        uint32_t cr3;
+        asm volatile("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) :: "memory");
+    }
+    VMSTAT_ADD(global ? &kernel_as : current_as, tlb_flushes, 1);
+}
+
+// vaddr 所在的 PDE：内核半边永远查 boot 页目录
+static inline page_directory_entry_t *vmm_pde(uintptr_t vaddr) {
+    page_directory_t *pd = vaddr >= KERNEL_VIRT_OFFSET ? kernel_pd : current_as->pd;
+    return &pd->entries[PDE_INDEX(vaddr)];
+}
+
+// 页表都在 physmap 里（boot 页表在内核 .bss，其他来自预清零池），直接换算
+static inline page_table_t *pde_table(const page_directory_entry_t *pde) {
+    return (page_table_t *)((uint32_t)FRAME_TO_PHYS(pde->frame) + KERNEL_VIRT_OFFSET);
+}
+
+// 交换项：页换到交换区或压缩进了 zram。不存在、也不是交换项的 PTE 才算真正空着
+static inline bool vmm_pte_is_swap(const page_table_entry_t *pte) {
+    return !pte->present && (pte->avail & (PTE_SWAP | PTE_ZRAM));
+}
+
+static inline bool vmm_pte_none(const page_table_entry_t *pte) {
+    return !pte->present && !(pte->avail & (PTE_SWAP | PTE_ZRAM));
+}
+
+static void vmm_swap_entry_dup(const page_table_entry_t *pte) {
+    if (pte->avail & PTE_ZRAM) {
+        zram_dup(pte->frame);
+    } else {
+        swap_dup(pte->frame);
+    }
+}
+
+static void vmm_swap_entry_free(const page_table_entry_t *pte) {
+    if (pte->avail & PTE_ZRAM) {
+        zram_free(pte->frame);
+    } else {
+        swap_free(pte->frame);
+    }
+}
+
+// flags 里的 VMM_CACHE_* -> PTE 的 PAT/PCD/PWT
+static inline void vmm_pte_set_cache(page_table_entry_t *pte, uint32_t flags) {
+    uint32_t idx = pat_index(flags);
+    pte->pwt = idx & 1;
+    pte->pcd = (idx >> 1) & 1;
+    pte->pat = (idx >> 2) & 1;
+}
+
+// 内核 PDE 改了以后同步到每个进程的页目录（PAE 下共享同一个页目录，不用同步）
+static void vmm_sync_kernel_pde(uint32_t pd_idx) {
+#ifdef KERNEL_PAE
+    (void)pd_idx;
+#else
+    for (address_space_t *as = as_list; as; as = as->next) {
+        as->pd->entries[pd_idx] = kernel_pd->entries[pd_idx];
+    }
+#endif
 }
 
 
 void vmm_init(void) {
-    // 1) 指向那个纯 PDE 数组
-    current_pd = &boot_page_directory;
-
-    // 2) 遍历所有 PDE，给每个 4 KiB 页表项挂上虚拟指针
-    for (int i = 0; i < PAGE_DIR_ENTRIES; i++) {
-        page_directory_entry_t pde = current_pd->entries[i];
-
-        // 只处理 “present 且 PS=0（4 KiB 页表）” 的情况
-        if (pde.present && pde.page_size == 0) {
-            // physical base of the page-table page
-            uint32_t pt_phys = pde.frame << 12;
-            // convert to kernel virtual, then store in your ref_tables[]
-            ref_tables[i] = (page_table_t*)(pt_phys + KERNEL_VIRT_OFFSET);
-        } else {
-            ref_tables[i] = NULL;
+    // 1) boot 页目录就是内核地址空间
+    kernel_as.pd = kernel_pd;
+#ifdef KERNEL_PAE
+    kernel_as.cr3 = (uint32_t)&boot_pdpt - KERNEL_VIRT_OFFSET;
+#else
+    kernel_as.cr3 = (uint32_t)kernel_pd - KERNEL_VIRT_OFFSET;
+#endif
+    current_as = &kernel_as;
+
+    // 2) 内核半边已有的映射（boot 页表、physmap 大页）都标成 Global
+    for (uint32_t i = KERNEL_PDE_START; i < PAGE_DIR_ENTRIES; i++) {
+        page_directory_entry_t *pde = &kernel_pd->entries[i];
+        if (!pde->present) {
+            continue;
+        }
+        if (pde->page_size) {
+            pde->global = 1;
+            continue;
+        }
+        page_table_t *pt = pde_table(pde);
+        for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; j++) {
+            if (pt->pages[j].present) {
+                pt->pages[j].global = 1;
+            }
         }
+        VMSTAT_ADD(&kernel_as, pt_pages, 1);
+    }
+
+    // 3) 打开 CR4.PGE（同时会冲掉整个 TLB，包括之前的非 Global 项）
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_PGE) : "memory");
+
+    // 4) VMA 缓存；建不起来就退回 kmalloc（vma_cache 之后不会再变，分配和释放走同一条路）
+    vma_cache = kmem_cache_create("vm_area", sizeof(vm_area_t), 0, 0, NULL);
+    if (!vma_cache) {
+        kprintf("vmm: vm_area cache creation failed, using kmalloc\n");
     }
 }
 
-int vmm_map_page(uintptr_t vaddr, uintptr_t paddr, uint32_t flags) {
-    uint32_t pd_idx = (vaddr >> 22) & 0x3FF;
-    uint32_t pt_idx = (vaddr >> 12) & 0x3FF;
+int vmm_map_page(uintptr_t vaddr, phys_addr_t paddr, uint32_t flags) {
+    uint32_t pd_idx = PDE_INDEX(vaddr);
+    uint32_t pt_idx = PTE_INDEX(vaddr);
 
-    page_directory_entry_t *pde = &current_pd->entries[pd_idx];
-    page_table_t *pt = ref_tables[pd_idx];
+    page_directory_entry_t *pde = vmm_pde(vaddr);
 
     bool want_user = (flags & VMM_USER) != 0;
+    bool kernel    = vaddr >= KERNEL_VIRT_OFFSET;
 
-    // 如果页表不存在，就新建一个
+    // 如果页表不存在，就新建一个（页表要能用 phys + KERNEL_VIRT_OFFSET 访问，拿预清零的页）
     if (!pde->present) {
-        uint32_t pt_phys = pmm_alloc_frame();
+        uint32_t pt_phys = (uint32_t)pmm_alloc_zeroed_frame();
         if (!pt_phys) {
             return -1;
         }
 
-        pt = (page_table_t *)(pt_phys + KERNEL_VIRT_OFFSET);
-        kmemset(pt, 0, sizeof(*pt));
+        pmm_page(pt_phys)->flags |= PG_PAGETABLE;
+        VMSTAT_ADD(vmm_as_of(vaddr), pt_pages, 1);
 
         pde->frame     = pt_phys >> 12;
         pde->present   = 1;
@@ -72,7 +259,9 @@ int vmm_map_page(uintptr_t vaddr, uintptr_t paddr, uint32_t flags) {
         pde->user      = want_user ? 1 : 0;
         pde->page_size = 0;
 
-        ref_tables[pd_idx] = pt;
+        if (kernel) {
+            vmm_sync_kernel_pde(pd_idx);
+        }
     } else {
         // PDE 已存在时，不允许跨权限域复用
         if (want_user && !pde->user) {
@@ -85,115 +274,1641 @@ int vmm_map_page(uintptr_t vaddr, uintptr_t paddr, uint32_t flags) {
             return -1;
         }
 
-        // 一般保持可写，简单点
-        if (flags & VMM_RW) {
-            pde->rw = 1;
+        // 大页（physmap 等）下面没有页表，不能再映射 4 KiB 页
+        if (pde->page_size) {
+            return -1;
         }
 
-        pt = ref_tables[pd_idx];
-        if (!pt) {
-            uint32_t pt_phys = pde->frame << 12;
-            pt = (page_table_t *)(pt_phys + KERNEL_VIRT_OFFSET);
-            ref_tables[pd_idx] = pt;
+        // 一般保持可写，简单点
+        if ((flags & VMM_RW) && !pde->rw) {
+            pde->rw = 1;
+            if (kernel) {
+                vmm_sync_kernel_pde(pd_idx);
+            }
         }
     }
 
+    page_table_t *pt = pde_table(pde);
     page_table_entry_t *pte = &pt->pages[pt_idx];
 
     // 如果你不想允许覆盖已有映射，可以打开这段：
     if (pte->present) {
         return -1;
     }
+    // 盖掉一个交换项：槽里的旧内容不要了
+    if (vmm_pte_is_swap(pte)) {
+        vmm_swap_entry_free(pte);
+    }
 
+    pte->avail   = 0;
     pte->frame   = paddr >> 12;
     pte->present = 1;
     pte->rw      = (flags & VMM_RW) ? 1 : 0;
     pte->user    = want_user ? 1 : 0;
+    pte->global  = (kernel && !want_user) ? 1 : 0;
+    vmm_pte_set_cache(pte, flags);
 
     vmm_invlpg(vaddr);
+    VMSTAT_ADD(vmm_as_of(vaddr), pages_mapped, 1);
+    return 0;
+}
+
+int vmm_set_cache(uintptr_t vaddr, uint32_t npages, uint32_t cache)
+{
+    // 先全部检查一遍，有问题就什么都不改
+    for (uint32_t i = 0; i < npages; i++) {
+        uintptr_t va = vaddr + i * PAGE_SIZE;
+        page_directory_entry_t *pde = vmm_pde(va);
+        if (!pde->present || pde->page_size ||
+            !pde_table(pde)->pages[PTE_INDEX(va)].present) {
+            return -1;
+        }
+    }
+
+    /*
+     * 按 SDM 的顺序：先撤掉映射并冲 TLB，这之后不会再按旧类型往缓存里装行；
+     * 再把旧类型下缓存的行写回作废；最后才装上新类型的映射。
+     * 中间这几页不在，关中断免得中断处理（比如往控制台打字）碰到它们
+     */
+    uint32_t eflags;
+    asm volatile("pushfl; popl %0; cli" : "=r"(eflags) :: "memory");
+
+    for (uint32_t i = 0; i < npages; i++) {
+        uintptr_t va = vaddr + i * PAGE_SIZE;
+        pde_table(vmm_pde(va))->pages[PTE_INDEX(va)].present = 0;
+        vmm_invlpg(va);
+    }
+
+    asm volatile("wbinvd" ::: "memory");
+
+    for (uint32_t i = 0; i < npages; i++) {
+        uintptr_t va = vaddr + i * PAGE_SIZE;
+        page_table_entry_t *pte = &pde_table(vmm_pde(va))->pages[PTE_INDEX(va)];
+        vmm_pte_set_cache(pte, cache);
+        pte->present = 1;
+        vmm_invlpg(va);
+    }
+
+    if (eflags & (1 << 9)) {
+        asm volatile("sti" ::: "memory");
+    }
     return 0;
 }
 
 
 int vmm_unmap_page(uintptr_t vaddr, bool free_frame) {
-    uint32_t pd_idx = (vaddr >> 22) & 0x3FF;
-    uint32_t pt_idx = (vaddr >> 12) & 0x3FF;
+    uint32_t pt_idx = PTE_INDEX(vaddr);
 
-    if (!current_pd->entries[pd_idx].present){
+    page_directory_entry_t *pde = vmm_pde(vaddr);
+    if (!pde->present || pde->page_size){
        return -1; 
     }
 
-    page_table_t *pt = ref_tables[pd_idx];
-    if (!pt || !pt->pages[pt_idx].present){
+    page_table_t *pt = pde_table(pde);
+    if (!pt->pages[pt_idx].present){
         return -1;
     }
 
     if (free_frame) {
-        uint32_t phys = pt->pages[pt_idx].frame << 12;
-        pmm_free_frame(phys);
+        // 页可能被多处映射，引用计数归零才真正释放
+        struct page *pg = pmm_page(FRAME_TO_PHYS(pt->pages[pt_idx].frame));
+        if (pg) {
+            page_put(pg);
+        }
     }
 
     pt->pages[pt_idx].present = 0;
     pt->pages[pt_idx].frame   = 0;
     pt->pages[pt_idx].rw      = 0;
     pt->pages[pt_idx].user    = 0;
+    pt->pages[pt_idx].global  = 0;
+    pt->pages[pt_idx].avail   = 0;
+
+    vmm_invlpg(vaddr);
+    VMSTAT_ADD(vmm_as_of(vaddr), pages_unmapped, 1);
+    return 0;
+}
+
+
+/*
+ * 用户大页：PS=1 的 PDE 直接映射 LARGE_PAGE_SIZE 的物理连续内存。
+ * 每个 4 KiB 子页照样有自己的页描述符（引用计数 1，PG_ANON），
+ * 所以拆成页表以后就是普通的匿名页，释放时也逐页 page_put，buddy 会自己合并回去。
+ * 大页不参与换出，fork 之前先拆开，COW 仍然按 4 KiB 做。
+ */
+static void vmm_huge_put(phys_addr_t phys)
+{
+    for (uint32_t i = 0; i < VMM_HUGE_PAGES; i++) {
+        page_put(pmm_page(phys + i * PAGE_SIZE));
+    }
+    huge_stats.mapped--;
+    huge_stats.frees++;
+}
+
+// 把 va 所在的用户大页拆成一张页表，权限不变
+static int vmm_split_huge(page_directory_entry_t *pde, uintptr_t va)
+{
+    uint32_t pt_phys = (uint32_t)pmm_alloc_zeroed_frame();
+    if (!pt_phys) {
+        return -1;
+    }
+    pmm_page(pt_phys)->flags |= PG_PAGETABLE;
+    VMSTAT_ADD(current_as, pt_pages, 1);
+
+    page_table_t *pt = (page_table_t *)(pt_phys + KERNEL_VIRT_OFFSET);
+    phys_addr_t phys = FRAME_TO_PHYS(pde->frame);
+    for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; j++) {
+        page_table_entry_t *pte = &pt->pages[j];
+        pte->frame   = (phys + j * PAGE_SIZE) >> 12;
+        pte->rw      = pde->rw;
+        pte->user    = pde->user;
+        pte->present = 1;
+    }
+
+    page_directory_entry_t e = { 0 };
+    e.present = 1;
+    e.rw      = pde->rw;
+    e.user    = 1;
+    e.frame   = pt_phys >> 12;
+    *pde = e;
+
+    // 一次 invlpg 就能把整个大页的 TLB 项冲掉
+    vmm_invlpg(va & ~(LARGE_PAGE_SIZE - 1));
+    huge_stats.mapped--;
+    huge_stats.splits++;
+    return 0;
+}
+
+void vmm_get_huge_stats(vmm_huge_stats_t *st)
+{
+    *st = huge_stats;
+}
+
+/*
+ * 批量 unmap（tlb_gather）：清 PTE 时只记下要失效的地址和要释放的页，
+ * 最后 tlb_gather_flush() 一次性处理：
+ *   - 记下的页数不超过 TLB_GATHER_MAX 就逐个 invlpg，超过了就整体冲刷
+ *     （只有用户映射时重载 CR3；有内核 Global 映射时拨一下 CR4.PGE）
+ *   - 冲完 TLB 才把数据页 page_put、把清空的页表还给 PMM，
+ *     这之前 CPU 可能还缓存着旧的翻译
+ */
+void tlb_gather_init(tlb_gather_t *tlb)
+{
+    tlb->nr_va     = 0;
+    tlb->flush_all = false;
+    tlb->global    = false;
+    tlb->nr_frames = 0;
+    tlb->nr_tables = 0;
+}
+
+static void tlb_gather_add_va(tlb_gather_t *tlb, uintptr_t vaddr)
+{
+    if (vaddr >= KERNEL_VIRT_OFFSET) {
+        tlb->global = true;
+    }
+    if (tlb->nr_va < TLB_GATHER_MAX) {
+        tlb->va[tlb->nr_va++] = vaddr;
+    } else {
+        tlb->flush_all = true;
+    }
+}
+
+void tlb_gather_flush(tlb_gather_t *tlb)
+{
+    if (tlb->flush_all) {
+        vmm_flush_tlb(tlb->global);
+    } else {
+        for (uint32_t i = 0; i < tlb->nr_va; i++) {
+            vmm_invlpg(tlb->va[i]);
+        }
+    }
 
-    asm volatile("invlpg (%0)" :: "r"(vaddr) : "memory");
+    for (uint32_t i = 0; i < tlb->nr_frames; i++) {
+        struct page *pg = pmm_page(tlb->frames[i]);
+        if (pg) {
+            page_put(pg);
+        }
+    }
+    for (uint32_t i = 0; i < tlb->nr_tables; i++) {
+        pmm_free_frame(tlb->tables[i]);
+    }
+
+    tlb_gather_init(tlb);
+}
+
+// 清掉一个 PTE，地址和页都交给 tlb 延后处理
+static void tlb_gather_clear_pte(tlb_gather_t *tlb, page_table_entry_t *pte,
+                                 uintptr_t vaddr, bool free_frame)
+{
+    if (free_frame) {
+        if (tlb->nr_frames == TLB_GATHER_MAX) {
+            tlb_gather_flush(tlb);
+        }
+        tlb->frames[tlb->nr_frames++] = FRAME_TO_PHYS(pte->frame);
+    }
+
+    pte->present = 0;
+    pte->frame   = 0;
+    pte->rw      = 0;
+    pte->user    = 0;
+    pte->global  = 0;
+    pte->avail   = 0;
+
+    tlb_gather_add_va(tlb, vaddr);
+    VMSTAT_ADD(vmm_as_of(vaddr), pages_unmapped, 1);
+}
+
+int vmm_unmap_page_gather(tlb_gather_t *tlb, uintptr_t vaddr, bool free_frame)
+{
+    page_directory_entry_t *pde = vmm_pde(vaddr);
+    if (!pde->present || pde->page_size) {
+        return -1;
+    }
+
+    page_table_entry_t *pte = &pde_table(pde)->pages[PTE_INDEX(vaddr)];
+    if (!pte->present) {
+        return -1;
+    }
+
+    tlb_gather_clear_pte(tlb, pte, vaddr, free_frame);
     return 0;
 }
 
+/*
+ * unmap [start, end) 里所有已映射的页。按页表一张一张走，
+ * 走完一张如果整张都空了，就把 PDE 清掉，页表放进 tlb 等冲刷后释放。
+ * boot 页表（内核 .bss 里的）不回收。
+ */
+void vmm_unmap_range_gather(tlb_gather_t *tlb, uintptr_t start, uintptr_t end, bool free_frames)
+{
+    extern uint8_t _kernel_end;
+    uint32_t boot_end = (uint32_t)&_kernel_end - KERNEL_VIRT_OFFSET;
+
+    uintptr_t va = start & ~(PAGE_SIZE - 1);
+    end = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    while (va < end) {
+        uintptr_t next = (va & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE;
+        if (next > end || next == 0) {
+            next = end;
+        }
+
+        page_directory_entry_t *pde = vmm_pde(va);
+        if (pde->present && pde->page_size && pde->user) {
+            uintptr_t block = va & ~(LARGE_PAGE_SIZE - 1);
+            if (va == block && next - block == LARGE_PAGE_SIZE) {
+                // 整个用户大页都在范围里：摘掉 PDE，冲完 TLB 再放子页
+                phys_addr_t phys = FRAME_TO_PHYS(pde->frame);
+                *pde = (page_directory_entry_t){ 0 };
+                tlb_gather_add_va(tlb, block);
+                tlb_gather_flush(tlb);
+                if (free_frames) {
+                    vmm_huge_put(phys);
+                } else {
+                    huge_stats.mapped--;
+                }
+                VMSTAT_ADD(current_as, pages_unmapped, VMM_HUGE_PAGES);
+                va = next;
+                continue;
+            }
+            // 只拆一部分：先拆成页表再按 4 KiB 处理；拆不了（没内存）就整个留着
+            if (vmm_split_huge(pde, va) < 0) {
+                va = next;
+                continue;
+            }
+        }
+        if (!pde->present || pde->page_size) {
+            va = next;
+            continue;
+        }
+
+        page_table_t *pt = pde_table(pde);
+        for (; va < next; va += PAGE_SIZE) {
+            page_table_entry_t *pte = &pt->pages[PTE_INDEX(va)];
+            if (pte->present) {
+                tlb_gather_clear_pte(tlb, pte, va, free_frames);
+            } else if (vmm_pte_is_swap(pte)) {
+                // 换出去的页没有 TLB 项，还掉交换槽就行
+                vmm_swap_entry_free(pte);
+                *pte = (page_table_entry_t){ 0 };
+            }
+        }
+
+        uint32_t pt_phys = (uint32_t)FRAME_TO_PHYS(pde->frame);
+        if (pt_phys < boot_end) {
+            continue;
+        }
+        uint32_t j = 0;
+        while (j < PAGE_TABLE_ENTRIES && vmm_pte_none(&pt->pages[j])) {
+            j++;
+        }
+        if (j < PAGE_TABLE_ENTRIES) {
+            continue;
+        }
+
+        // 整张页表空了：先摘掉 PDE，冲完 TLB 再释放
+        if (tlb->nr_tables == TLB_GATHER_TABLES) {
+            tlb_gather_flush(tlb);
+        }
+        uintptr_t table_va = (va - 1) & ~(LARGE_PAGE_SIZE - 1);
+        *pde = (page_directory_entry_t){ 0 };
+        if (table_va >= KERNEL_VIRT_OFFSET) {
+            vmm_sync_kernel_pde(PDE_INDEX(table_va));
+        }
+        tlb->tables[tlb->nr_tables++] = pt_phys;
+        VMSTAT_SUB(vmm_as_of(table_va), pt_pages, 1);
+        // invlpg 会连带清掉分页结构缓存，记一个这张页表管的地址就够了
+        tlb_gather_add_va(tlb, table_va);
+    }
+}
 
-uint32_t vmm_translate(uintptr_t vaddr) {
-    uint32_t pd_idx   = (vaddr >> 22) & 0x3FF;
-    uint32_t pt_idx   = (vaddr >> 12) & 0x3FF;
+phys_addr_t vmm_translate(uintptr_t vaddr) {
+    uint32_t pt_idx   = PTE_INDEX(vaddr);
     uint32_t offset   =  vaddr & 0xFFF;
 
-    if (!current_pd->entries[pd_idx].present) return 0;
-    page_table_t *pt = ref_tables[pd_idx];
+    page_directory_entry_t *pde = vmm_pde(vaddr);
+    if (!pde->present) return 0;
+    if (pde->page_size) {
+        return FRAME_TO_PHYS(pde->frame) | (vaddr & (LARGE_PAGE_SIZE - 1));
+    }
+    page_table_t *pt = pde_table(pde);
     if (!pt->pages[pt_idx].present)      return 0;
 
-    return (pt->pages[pt_idx].frame << 12) | offset;
+    return FRAME_TO_PHYS(pt->pages[pt_idx].frame) | offset;
 }
 
-int vmm_map_region(uintptr_t vstart,
-                   uintptr_t vend,
-                   uintptr_t pstart,
-                   uint32_t flags)
+/*
+ * unmap microbenchmark：在内核地址空间的用户半边把同一个物理页映射 n 次
+ * （都读一遍，让 TLB 里有这些项），然后分别用逐页 vmm_unmap_page() 和
+ * tlb_gather 一次性 unmap，报告每页平均 cycles。不释放物理页，只测 unmap 和 TLB。
+ */
+#define UNMAP_BENCH_VA 0x10000000U
+
+static uint32_t vmm_bench_unmap_once(phys_addr_t frame, uint32_t n, bool batched)
 {
-    // 向下对齐起点，向上对齐终点
-    uintptr_t va = vstart & ~(PAGE_SIZE - 1);
-    uintptr_t end = (vend + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    for (uint32_t i = 0; i < n; i++) {
+        vmm_map_page(UNMAP_BENCH_VA + i * PAGE_SIZE, frame, VMM_PRESENT | VMM_RW);
+        (void)*(volatile uint8_t *)(UNMAP_BENCH_VA + i * PAGE_SIZE);
+    }
 
-    while (va < end) {
-        uintptr_t phys;
-        if (pstart)
-            phys = pstart + (va - vstart);
-        else
-            phys = pmm_alloc_frame();  // 直接返回物理地址
+    uint64_t t0 = rdtsc();
+    if (batched) {
+        vmm_unmap_region(UNMAP_BENCH_VA, UNMAP_BENCH_VA + n * PAGE_SIZE, false);
+    } else {
+        for (uint32_t i = 0; i < n; i++) {
+            vmm_unmap_page(UNMAP_BENCH_VA + i * PAGE_SIZE, false);
+        }
+    }
+    return (uint32_t)(rdtsc() - t0) / n;
+}
 
-        if (!phys)
-            return -1;
+static void vmm_bench_unmap(void)
+{
+    static const uint32_t sizes[] = { 1, 64, 4096 };
+    phys_addr_t frame = pmm_alloc_frame();
+    if (!frame) {
+        kprintf("vmm bench: no frame for unmap bench\n");
+        return;
+    }
 
-        if (vmm_map_page(va, phys, flags) < 0)
-            return -1;
+    for (uint32_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        uint32_t per_page = vmm_bench_unmap_once(frame, sizes[k], false);
+        uint32_t batched  = vmm_bench_unmap_once(frame, sizes[k], true);
+        kprintf("vmm bench: unmap %u pages: %u cycles/page per-page invlpg, %u cycles/page batched\n",
+                sizes[k], per_page, batched);
+    }
+    // 最后一轮是批量 unmap，页表也已经回收了
+    pmm_free_frame(frame);
+}
 
-        va += PAGE_SIZE;
+// 填一个 PS=1 的大页 PDE，内核大页同时标成 Global
+static void vmm_set_large_pde(page_directory_entry_t *pde, phys_addr_t paddr, uint32_t flags)
+{
+    page_directory_entry_t e = { 0 };
+    e.present   = 1;
+    e.rw        = (flags & VMM_RW) ? 1 : 0;
+    e.user      = (flags & VMM_USER) ? 1 : 0;
+    e.page_size = 1;
+    e.global    = (flags & VMM_USER) ? 0 : 1;
+    e.frame     = paddr >> 12;
+    *pde = e;
+}
+
+/*
+ * 用大页（经典分页 4 MiB PSE，PAE 下 2 MiB）映射内核区域 [vaddr, vaddr + size)。
+ * vaddr、paddr、size 都要按 LARGE_PAGE_SIZE 对齐，范围必须在内核半边，
+ * 范围内的 PDE 必须都还没用过，否则什么都不改，返回 -1。
+ */
+int vmm_map_large(uintptr_t vaddr, phys_addr_t paddr, uint32_t size, uint32_t flags)
+{
+    if ((vaddr | (uint32_t)paddr | size) & (LARGE_PAGE_SIZE - 1)) {
+        return -1;
+    }
+    if (!size || vaddr < KERNEL_VIRT_OFFSET || vaddr + size - 1 < vaddr) {
+        return -1;
+    }
+
+    for (uint32_t off = 0; off < size; off += LARGE_PAGE_SIZE) {
+        if (vmm_pde(vaddr + off)->present) {
+            return -1;
+        }
+    }
+    for (uint32_t off = 0; off < size; off += LARGE_PAGE_SIZE) {
+        vmm_set_large_pde(vmm_pde(vaddr + off), paddr + off, flags);
+        vmm_sync_kernel_pde(PDE_INDEX(vaddr + off));
     }
     return 0;
 }
 
-int vmm_unmap_region(uintptr_t vstart,
-                     uintptr_t vend,
-                     bool free_frames)
+/*
+ * 内核 physmap：把低端内存里的物理 [start, end)（到 PMM_DIRECT_LIMIT 为止）
+ * 映射到 KERNEL_VIRT_OFFSET + phys。pmm_init 在 vmm_init 之前调用，直接改 boot 页目录。
+ * 低 4 MiB 里有 VGA 别名（0xC03FF000）和内核镜像，继续用 boot 页表；
+ * 4 MiB 以上整块落在范围里的用大页，改完重载 CR3。
+ * 首尾不满一个大页的部分只映射范围里的 4 KiB 页：大页会把旁边的 MMIO、
+ * ACPI 之类的保留区也按 WB 映射进来。这时候还没有 PMM，页表从 .bss 的小池子里拿；
+ * boot.S 已经建了页表的（16 MiB 以下）直接用原来的。
+ */
+#define PHYSMAP_LARGE_START 0x00400000U
+#define PHYSMAP_TABLES      16
+
+static page_table_t physmap_tables[PHYSMAP_TABLES];
+static uint32_t physmap_tables_used;
+
+static void vmm_map_physmap_small(uint32_t start, uint32_t end)
 {
-    uintptr_t va = vstart & ~(PAGE_SIZE - 1);
-    uintptr_t end = (vend + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    page_directory_entry_t *pde = &kernel_pd->entries[PDE_INDEX(start + KERNEL_VIRT_OFFSET)];
+    if (!pde->present || pde->page_size) {
+        if (physmap_tables_used == PHYSMAP_TABLES) {
+            kprintf("physmap: out of boot page tables at 0x%x\n", start);
+            for (;;);  /* 没法恢复：PMM 会把这段当成能直接访问的内存 */
+        }
+        page_table_t *pt = &physmap_tables[physmap_tables_used++];
+        page_directory_entry_t e = { 0 };
+        e.present = 1;
+        e.rw      = 1;
+        e.frame   = ((uint32_t)pt - KERNEL_VIRT_OFFSET) >> 12;
+        *pde = e;
+    }
 
-    while (va < end) {
-        // 忽略返回值：即使某页没映射也往下走
-        vmm_unmap_page(va, free_frames);
-        va += PAGE_SIZE;
+    page_table_t *pt = pde_table(pde);
+    for (uint32_t pa = start; pa < end; pa += PAGE_SIZE) {
+        page_table_entry_t *pte = &pt->pages[PTE_INDEX(pa)];
+        pte->frame   = pa >> 12;
+        pte->present = 1;
+        pte->rw      = 1;
+        pte->global  = 1;
+    }
+}
+
+void vmm_map_physmap(uint32_t start, uint32_t end)
+{
+    if (start < PHYSMAP_LARGE_START) start = PHYSMAP_LARGE_START;
+    if (end > PMM_DIRECT_LIMIT)      end   = PMM_DIRECT_LIMIT;
+
+    uint32_t pa = start;
+    while (pa < end) {
+        uint32_t next = (pa & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE;
+        if ((pa & (LARGE_PAGE_SIZE - 1)) == 0 && next <= end) {
+            vmm_set_large_pde(&kernel_pd->entries[PDE_INDEX(pa + KERNEL_VIRT_OFFSET)],
+                              pa, VMM_PRESENT | VMM_RW);
+        } else {
+            vmm_map_physmap_small(pa, next < end ? next : end);
+        }
+        pa = next;
     }
+
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) :: "memory");
+}
+
+/*
+ * VMA：用户半边的每一段区域（ELF 段、堆、栈、mmap）一个描述符，挂在地址空间的
+ * AVL 树上，按 start 排序，缺页时 O(log n) 找到所在区域。区域互不重叠，
+ * 长度为 0 的区域（刚初始化的堆）只占个位置。
+ */
+static int vmm_vma_cmp(const avl_node_t *a, const avl_node_t *b)
+{
+    uintptr_t sa = avl_entry(a, vm_area_t, node)->start;
+    uintptr_t sb = avl_entry(b, vm_area_t, node)->start;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+static vm_area_t *vmm_vma_find(address_space_t *as, uintptr_t addr)
+{
+    avl_node_t *n = as->vmas.root;
+    while (n) {
+        vm_area_t *vma = avl_entry(n, vm_area_t, node);
+        if (addr < vma->start) {
+            n = n->left;
+        } else if (addr >= vma->end) {
+            n = n->right;
+        } else {
+            return vma;
+        }
+    }
+    return NULL;
+}
+
+// 第一个 end > addr 的非空区域
+static vm_area_t *vmm_vma_lower_bound(address_space_t *as, uintptr_t addr)
+{
+    vm_area_t *best = NULL;
+    avl_node_t *n = as->vmas.root;
+    while (n) {
+        vm_area_t *vma = avl_entry(n, vm_area_t, node);
+        if (vma->end > addr) {
+            best = vma;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+    while (best && best->start == best->end) {
+        avl_node_t *next = avl_next(&best->node);
+        best = next ? avl_entry(next, vm_area_t, node) : NULL;
+    }
+    return best;
+}
+
+static vm_area_t *vmm_vma_next(vm_area_t *vma)
+{
+    avl_node_t *n = avl_next(&vma->node);
+    return n ? avl_entry(n, vm_area_t, node) : NULL;
+}
+
+/*
+ * 空区域 [s, s)（刚建好、还没长的堆）也算占着 s 这一页：别的区域盖住 s 的话，
+ * 堆长不出来，sbrk 按起点找区域时还可能找到别人
+ */
+static uintptr_t vmm_vma_occupied_end(const vm_area_t *vma)
+{
+    return vma->start == vma->end ? vma->start + PAGE_SIZE : vma->end;
+}
+
+// 第一个占用范围结束在 addr 之后的区域，空区域也算
+static vm_area_t *vmm_vma_first_occupying(address_space_t *as, uintptr_t addr)
+{
+    vm_area_t *best = NULL;
+    avl_node_t *n = as->vmas.root;
+    while (n) {
+        vm_area_t *vma = avl_entry(n, vm_area_t, node);
+        if (vmm_vma_occupied_end(vma) > addr) {
+            best = vma;
+            n = n->left;
+        } else {
+            n = n->right;
+        }
+    }
+    return best;
+}
+
+// [start, end) 和别的区域（不算 self）有没有重叠；start == end 时按占着 start 这一页算
+static bool vmm_vma_overlaps(address_space_t *as, const vm_area_t *self,
+                             uintptr_t start, uintptr_t end)
+{
+    if (end == start) {
+        end = start + PAGE_SIZE;
+    }
+    for (vm_area_t *vma = vmm_vma_first_occupying(as, start);
+         vma && vma->start < end; vma = vmm_vma_next(vma)) {
+        if (vma != self) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static vm_area_t *vmm_vma_alloc(void)
+{
+    return vma_cache ? kmem_cache_alloc(vma_cache) : kmalloc(sizeof(vm_area_t));
+}
+
+static void vmm_vma_free(vm_area_t *vma)
+{
+    if (vma_cache) {
+        kmem_cache_free(vma_cache, vma);
+    } else {
+        kfree(vma);
+    }
+}
+
+static vm_area_t *vmm_vma_insert(address_space_t *as, uintptr_t start,
+                                 uintptr_t end, uint32_t flags)
+{
+    vm_area_t *vma = vmm_vma_alloc();
+    if (!vma) {
+        return NULL;
+    }
+    vma->start = start;
+    vma->end   = end;
+    vma->flags = flags;
+    vma->source      = NULL;
+    vma->source_data = NULL;
+    vma->pgoff       = 0;
+    avl_insert(&as->vmas, &vma->node, vmm_vma_cmp);
+    as->nr_vmas++;
+    return vma;
+}
+
+static void vmm_vma_erase(address_space_t *as, vm_area_t *vma)
+{
+    avl_remove(&as->vmas, &vma->node);
+    as->nr_vmas--;
+    if (vma->source) {
+        vma->source->release(vma->source_data);
+    }
+    vmm_vma_free(vma);
+}
+
+// 在 addr 处把区域切成两段，返回后一段；后一段的 start 比原来大，树里的顺序不变
+static vm_area_t *vmm_vma_split(address_space_t *as, vm_area_t *vma, uintptr_t addr)
+{
+    vm_area_t *tail = vmm_vma_insert(as, addr, vma->end, vma->flags);
+    if (tail) {
+        tail->source      = vma->source;
+        tail->source_data = vma->source_data;
+        tail->pgoff       = vma->pgoff + (addr - vma->start) / PAGE_SIZE;
+        if (tail->source) {
+            tail->source->hold(tail->source_data);
+        }
+        vma->end = addr;
+    }
+    return tail;
+}
+
+static int vmm_vma_copy(address_space_t *dst, address_space_t *src)
+{
+    for (avl_node_t *n = avl_first(&src->vmas); n; n = avl_next(n)) {
+        vm_area_t *vma = avl_entry(n, vm_area_t, node);
+        vm_area_t *copy = vmm_vma_insert(dst, vma->start, vma->end, vma->flags);
+        if (!copy) {
+            return -1;
+        }
+        copy->source      = vma->source;
+        copy->source_data = vma->source_data;
+        copy->pgoff       = vma->pgoff;
+        if (copy->source) {
+            copy->source->hold(copy->source_data);
+        }
+    }
+    return 0;
+}
+
+static void vmm_vma_free_all(address_space_t *as)
+{
+    while (as->vmas.root) {
+        vmm_vma_erase(as, avl_entry(as->vmas.root, vm_area_t, node));
+    }
+}
+
+// 新建一个用户地址空间：用户半边是空的，内核半边和 boot 页目录共享
+address_space_t *vmm_as_create(void)
+{
+    address_space_t *as = kmalloc(sizeof(*as));
+    if (!as) {
+        return NULL;
+    }
+
+#ifdef KERNEL_PAE
+    // 4 页连续：前 3 页是用户页目录（0-3 GiB），第 4 页开头放 PDPT
+    uint32_t block = (uint32_t)pmm_alloc_pages_zone(2, PMM_ZONE_NORMAL);
+    if (!block) {
+        kfree(as);
+        return NULL;
+    }
+    kmemset((void *)(block + KERNEL_VIRT_OFFSET), 0, 4 * PAGE_SIZE);
+
+    page_dir_pointer_table_t *pdpt =
+        (page_dir_pointer_table_t *)(block + 3 * PAGE_SIZE + KERNEL_VIRT_OFFSET);
+    for (uint32_t i = 0; i < PDPT_ENTRIES; i++) {
+        uint32_t pd_phys = i < 3 ? block + i * PAGE_SIZE
+                                 : (uint32_t)kernel_pd - KERNEL_VIRT_OFFSET + 3 * PAGE_SIZE;
+        pdpt->entries[i].present = 1;
+        pdpt->entries[i].frame   = pd_phys >> 12;
+    }
+    pmm_page(block)->flags |= PG_PAGETABLE;
+    as->pd  = (page_directory_t *)(block + KERNEL_VIRT_OFFSET);
+    as->cr3 = block + 3 * PAGE_SIZE;
+#else
+    uint32_t pd_phys = (uint32_t)pmm_alloc_zeroed_frame();
+    if (!pd_phys) {
+        kfree(as);
+        return NULL;
+    }
+    pmm_page(pd_phys)->flags |= PG_PAGETABLE;
+    as->pd  = (page_directory_t *)(pd_phys + KERNEL_VIRT_OFFSET);
+    as->cr3 = pd_phys;
+
+    for (uint32_t i = KERNEL_PDE_START; i < PAGE_DIR_ENTRIES; i++) {
+        as->pd->entries[i] = kernel_pd->entries[i];
+    }
+#endif
+
+    as->vmas.root = NULL;
+    as->nr_vmas   = 0;
+    as->stat      = (vmstat_t){ 0 };
+    as->next = as_list;
+    as_list  = as;
+    return as;
+}
+
+/*
+ * fork：复制当前地址空间的用户半边。页表是新的，数据页两边共享：
+ * 可写的页两边都改成只读并打上 PTE_COW，谁先写谁在缺页里复制一份；
+ * 只读的页（共享零页等）原样共享。只复制页表，不复制数据，所以很快。
+ */
+address_space_t *vmm_as_fork(void)
+{
+    address_space_t *parent = current_as;
+    if (parent == &kernel_as) {
+        return NULL;
+    }
+
+    address_space_t *child = vmm_as_create();
+    if (!child) {
+        return NULL;
+    }
+    bool ok = vmm_vma_copy(child, parent) == 0;
+    for (uint32_t i = 0; i < KERNEL_PDE_START && ok; i++) {
+        page_directory_entry_t *pde = &parent->pd->entries[i];
+        // 大页先拆开，下面逐页打 COW
+        if (pde->present && pde->page_size && vmm_split_huge(pde, i << PDE_SHIFT) < 0) {
+            ok = false;
+            break;
+        }
+        if (!pde->present || pde->page_size) {
+            continue;
+        }
+
+        uint32_t pt_phys = (uint32_t)pmm_alloc_zeroed_frame();
+        if (!pt_phys) {
+            ok = false;
+            break;
+        }
+        pmm_page(pt_phys)->flags |= PG_PAGETABLE;
+        VMSTAT_ADD(child, pt_pages, 1);
+
+        page_table_t *ppt = pde_table(pde);
+        page_table_t *cpt = (page_table_t *)(pt_phys + KERNEL_VIRT_OFFSET);
+        for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; j++) {
+            page_table_entry_t *pte = &ppt->pages[j];
+            if (vmm_pte_is_swap(pte)) {
+                // 换出去的页两边共用交换槽，谁先缺页谁读回一份自己的
+                vmm_swap_entry_dup(pte);
+                cpt->pages[j] = *pte;
+                continue;
+            }
+            if (!pte->present) {
+                continue;
+            }
+            if (pte->rw) {
+                pte->rw     = 0;
+                pte->avail |= PTE_COW;
+            }
+            cpt->pages[j] = *pte;
+            VMSTAT_ADD(child, pages_mapped, 1);
+
+            struct page *pg = pmm_page(FRAME_TO_PHYS(pte->frame));
+            if (pg) {
+                page_get(pg);
+            }
+        }
+
+        child->pd->entries[i] = *pde;
+        child->pd->entries[i].frame = pt_phys >> 12;
+    }
+
+    // 父进程的页刚被改成只读，TLB 里旧的可写项要冲掉（用户页不是 Global）
+    vmm_flush_tlb(false);
+
+    if (!ok) {
+        // 已经打了 COW 标记的父进程页没关系：引用计数回到 1，第一次写时直接改回可写
+        vmm_as_destroy(child);
+        return NULL;
+    }
+    return child;
+}
+
+// 释放一个地址空间：用户页（按引用计数）、用户页表和页目录。不能释放正在用的
+void vmm_as_destroy(address_space_t *as)
+{
+    if (!as || as == &kernel_as || as == current_as) {
+        return;
+    }
+
+    for (address_space_t **pp = &as_list; *pp; pp = &(*pp)->next) {
+        if (*pp == as) {
+            *pp = as->next;
+            break;
+        }
+    }
+    if (clock_as == as) {
+        clock_as = NULL;
+    }
+
+    for (uint32_t i = 0; i < KERNEL_PDE_START; i++) {
+        page_directory_entry_t *pde = &as->pd->entries[i];
+        if (pde->present && pde->page_size) {
+            vmm_huge_put(FRAME_TO_PHYS(pde->frame));
+            VMSTAT_ADD(as, pages_unmapped, VMM_HUGE_PAGES);
+            continue;
+        }
+        if (!pde->present) {
+            continue;
+        }
+        page_table_t *pt = pde_table(pde);
+        for (uint32_t j = 0; j < PAGE_TABLE_ENTRIES; j++) {
+            if (pt->pages[j].present) {
+                struct page *pg = pmm_page(FRAME_TO_PHYS(pt->pages[j].frame));
+                if (pg) {
+                    page_put(pg);
+                }
+                VMSTAT_ADD(as, pages_unmapped, 1);
+            } else if (vmm_pte_is_swap(&pt->pages[j])) {
+                vmm_swap_entry_free(&pt->pages[j]);
+            }
+        }
+        pmm_free_frame(FRAME_TO_PHYS(pde->frame));
+        VMSTAT_SUB(as, pt_pages, 1);
+    }
+
+    vmm_vma_free_all(as);
+
+#ifdef KERNEL_PAE
+    pmm_free_pages((uint32_t)as->pd - KERNEL_VIRT_OFFSET, 2);
+#else
+    pmm_free_frame(as->cr3);
+#endif
+    kfree(as);
+}
+
+// 切换地址空间：只重载 CR3，Global 的内核映射留在 TLB 里
+void vmm_as_switch(address_space_t *as)
+{
+    if (as == current_as) {
+        return;
+    }
+    current_as = as;
+    asm volatile("mov %0, %%cr3" :: "r"(as->cr3) : "memory");
+}
+
+address_space_t *vmm_as_current(void)
+{
+    return current_as;
+}
+
+address_space_t *vmm_as_kernel(void)
+{
+    return &kernel_as;
+}
+
+/*
+ * 按需分配（demand paging）：用户区域只登记范围，第一次访问缺页时才分配。
+ *   读缺页：映射全局共享的零页，只读
+ *   写缺页：拿一页预清零的页映射上去；写零页（权限错误）时换成自己的页
+ * 零页标成 PG_RESERVED，page_get/page_put 不动它，unmap 和销毁地址空间都不会释放。
+ */
+static phys_addr_t zero_page;
+
+static phys_addr_t vmm_zero_page(void)
+{
+    if (!zero_page) {
+        zero_page = pmm_alloc_zeroed_frame();
+        if (zero_page) {
+            pmm_page(zero_page)->flags |= PG_RESERVED;
+        }
+    }
+    return zero_page;
+}
+
+int vmm_vma_add(uintptr_t start, uintptr_t end, uint32_t flags)
+{
+    address_space_t *as = current_as;
+
+    start = start & ~(PAGE_SIZE - 1);
+    end   = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    if (as == &kernel_as || start > end || end > KERNEL_VIRT_OFFSET) {
+        return -1;
+    }
+    if (vmm_vma_overlaps(as, NULL, start, end)) {
+        return -1;
+    }
+    return vmm_vma_insert(as, start, end, flags) ? 0 : -1;
+}
+
+// 改区域的结尾（sbrk 用）；缩小时调用者自己 unmap 掉多出来的页
+int vmm_vma_resize(uintptr_t start, uintptr_t new_end)
+{
+    address_space_t *as = current_as;
+
+    new_end = (new_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    avl_node_t *n = as->vmas.root;
+    while (n) {
+        vm_area_t *vma = avl_entry(n, vm_area_t, node);
+        if (start < vma->start) {
+            n = n->left;
+        } else if (start > vma->start) {
+            n = n->right;
+        } else {
+            if (new_end < start || new_end > KERNEL_VIRT_OFFSET ||
+                vmm_vma_overlaps(as, vma, start, new_end)) {
+                return -1;
+            }
+            vma->end = new_end;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// mmap 不指定地址时，在 [VMM_MMAP_BASE, VMM_MMAP_TOP) 里从低往高找第一个放得下的空洞
+static uintptr_t vmm_vma_find_gap(address_space_t *as, uint32_t len)
+{
+    uintptr_t start = VMM_MMAP_BASE;
+
+    for (vm_area_t *vma = vmm_vma_first_occupying(as, start);
+         vma && vma->start < VMM_MMAP_TOP; vma = vmm_vma_next(vma)) {
+        if (vma->start >= start && vma->start - start >= len) {
+            break;
+        }
+        if (vmm_vma_occupied_end(vma) > start) {
+            start = vmm_vma_occupied_end(vma);
+        }
+    }
+
+    if (start >= VMM_MMAP_TOP || VMM_MMAP_TOP - start < len) {
+        return 0;
+    }
+    return start;
+}
+
+int vmm_vma_map_source(uintptr_t *addr, uint32_t len, uint32_t flags, bool fixed,
+                       const vmm_page_source_t *source, void *data, uint32_t pgoff)
+{
+    address_space_t *as = current_as;
+    uintptr_t start;
+
+    len = (len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (as == &kernel_as || len == 0) {
+        return -1;
+    }
+
+    if (fixed) {
+        // MAP_FIXED：原来在这里的映射先拆掉
+        start = *addr;
+        if ((start & (PAGE_SIZE - 1)) || start > KERNEL_VIRT_OFFSET ||
+            KERNEL_VIRT_OFFSET - start < len) {
+            return -1;
+        }
+        if (vmm_vma_unmap(start, start + len) < 0) {
+            return -1;
+        }
+        // unmap 不拆空区域：盖住还没长的堆的起点就拒绝
+        if (vmm_vma_overlaps(as, NULL, start, start + len)) {
+            return -1;
+        }
+    } else {
+        start = vmm_vma_find_gap(as, len);
+        if (!start) {
+            return -1;
+        }
+    }
+
+    // 只登记区域，页在第一次访问时才分配（或从 source 拿）
+    vm_area_t *vma = vmm_vma_insert(as, start, start + len, flags);
+    if (!vma) {
+        return -1;
+    }
+    vma->source      = source;
+    vma->source_data = data;
+    vma->pgoff       = pgoff;
+    *addr = start;
+    return 0;
+}
+
+int vmm_vma_map(uintptr_t *addr, uint32_t len, uint32_t flags, bool fixed)
+{
+    return vmm_vma_map_source(addr, len, flags, fixed, NULL, NULL, 0);
+}
+
+int vmm_vma_unmap(uintptr_t start, uintptr_t end)
+{
+    address_space_t *as = current_as;
+
+    start = start & ~(PAGE_SIZE - 1);
+    end   = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (as == &kernel_as || start >= end || end > KERNEL_VIRT_OFFSET) {
+        return -1;
+    }
+
+    vm_area_t *vma = vmm_vma_lower_bound(as, start);
+    while (vma && vma->start < end) {
+        if (vma->start == vma->end) {
+            vma = vmm_vma_next(vma);
+            continue;
+        }
+        // 跨边界的区域先切开，只删范围里面的那段
+        if (vma->start < start) {
+            vma = vmm_vma_split(as, vma, start);
+            if (!vma) {
+                return -1;
+            }
+        }
+        if (vma->end > end && !vmm_vma_split(as, vma, end)) {
+            return -1;
+        }
+        vm_area_t *next = vmm_vma_next(vma);
+        vmm_vma_erase(as, vma);
+        vma = next;
+    }
+
+    return vmm_unmap_region(start, end, true);
+}
+
+// 按区域新的权限改一个已经映射的 PTE；要变成可写但还共享着的页留给写缺页处理
+static void vmm_pte_protect(page_table_entry_t *pte, uint32_t flags)
+{
+    pte->user = (flags & VMM_USER) ? 1 : 0;
+    if (!(flags & VMM_USER) || !(flags & VMM_RW)) {
+        pte->rw = 0;
+        return;
+    }
+    if (pte->rw) {
+        return;
+    }
+
+    phys_addr_t phys = FRAME_TO_PHYS(pte->frame);
+    if ((zero_page && phys == zero_page) || (pte->avail & PTE_COW)) {
+        return;
+    }
+    struct page *pg = pmm_page(phys);
+    if (pg && pg->refcount > 1) {
+        // fork 时是只读的，两边一直共享着：以后谁写谁复制
+        pte->avail |= PTE_COW;
+        return;
+    }
+    pte->rw = 1;
+}
+
+int vmm_vma_protect(uintptr_t start, uintptr_t end, uint32_t flags)
+{
+    address_space_t *as = current_as;
+
+    start = start & ~(PAGE_SIZE - 1);
+    end   = (end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (as == &kernel_as || start >= end || end > KERNEL_VIRT_OFFSET) {
+        return -1;
+    }
+
+    // 整个范围都要有区域覆盖，中间有空洞就什么都不改
+    uintptr_t covered = start;
+    for (vm_area_t *vma = vmm_vma_lower_bound(as, start);
+         vma && vma->start < end && covered < end; vma = vmm_vma_next(vma)) {
+        if (vma->start > covered) {
+            return -1;
+        }
+        // 文件映射只读，不能改成可写
+        if (vma->source && (flags & VMM_RW) && vma->start != vma->end) {
+            return -1;
+        }
+        covered = vma->end;
+    }
+    if (covered < end) {
+        return -1;
+    }
+
+    // 只改了一部分的大页（只可能在两头）先拆成页表：拆不了就什么都还没改，直接失败。
+    // 拆本身不改权限，后面失败了也不用还原
+    uintptr_t ends[2] = { start, end - 1 };
+    for (int i = 0; i < 2; i++) {
+        uintptr_t block = ends[i] & ~(LARGE_PAGE_SIZE - 1);
+        page_directory_entry_t *pde = vmm_pde(block);
+        if (pde->present && pde->page_size &&
+            (block < start || block + LARGE_PAGE_SIZE > end) &&
+            vmm_split_huge(pde, block) < 0) {
+            return -1;
+        }
+    }
+
+    vm_area_t *vma = vmm_vma_lower_bound(as, start);
+    while (vma && vma->start < end) {
+        if (vma->start == vma->end) {
+            vma = vmm_vma_next(vma);
+            continue;
+        }
+        if (vma->start < start) {
+            vma = vmm_vma_split(as, vma, start);
+            if (!vma) {
+                return -1;
+            }
+        }
+        if (vma->end > end && !vmm_vma_split(as, vma, end)) {
+            return -1;
+        }
+        vma->flags = flags;
+        vma = vmm_vma_next(vma);
+    }
+
+    // 已经映射的页按新权限改 PTE，一张页表一张页表地走
+    for (uintptr_t va = start; va < end; ) {
+        uintptr_t next = (va + LARGE_PAGE_SIZE) & ~(LARGE_PAGE_SIZE - 1);
+        if (next > end) {
+            next = end;
+        }
+
+        page_directory_entry_t *pde = vmm_pde(va);
+        if (pde->present && pde->page_size) {
+            // 整个大页一起改权限（大页不共享，可写就直接可写）；只改一部分的上面已经拆开了
+            pde->user = (flags & VMM_USER) ? 1 : 0;
+            pde->rw   = (flags & (VMM_USER | VMM_RW)) == (VMM_USER | VMM_RW);
+            va = next;
+            continue;
+        }
+        if (pde->present && !pde->page_size) {
+            page_table_t *pt = pde_table(pde);
+            if (flags & VMM_RW) {
+                pde->rw = 1;
+            }
+            for (; va < next; va += PAGE_SIZE) {
+                page_table_entry_t *pte = &pt->pages[PTE_INDEX(va)];
+                if (pte->present) {
+                    vmm_pte_protect(pte, flags);
+                }
+            }
+        }
+        va = next;
+    }
+
+    // 用户页不是 Global，重载 CR3 就都冲掉了
+    vmm_flush_tlb(false);
+    return 0;
+}
+
+/*
+ * 回收：clock（second chance）算法扫所有进程的用户 PTE，指针停在上次的位置。
+ *   Accessed 位为 1：最近用过，清掉 A 位放过它，等指针转回来再看
+ *   Accessed 位为 0：转了一圈都没人碰，写到交换区，PTE 改成交换项，物理页还给 PMM
+ * 只换出只有一处映射、在 physmap 里的匿名页；COW 共享的页、零页、文件页、页表、大页都不动。
+ * 别的地址空间的用户页不在 TLB 里（切 CR3 时冲掉了），只有当前地址空间要 invlpg。
+ * 返回换出的页数。
+ */
+static bool vmm_swap_candidate(const page_table_entry_t *pte)
+{
+    if (!pte->present || !pte->user) {
+        return false;
+    }
+    phys_addr_t phys = FRAME_TO_PHYS(pte->frame);
+    if (phys >= PMM_DIRECT_LIMIT) {
+        return false;
+    }
+    struct page *pg = pmm_page(phys);
+    if (!pg || (pg->flags & (PG_RESERVED | PG_PINNED))) {
+        return false;
+    }
+    // 页缓存的页是干净的，谁映射着都可以撤掉；匿名页只换出独占的
+    return (pg->flags & PG_FILE) || (pg->refcount == 1 && (pg->flags & PG_ANON));
+}
+
+// 先压缩进 zram（不碰磁盘），压不动或池满了才写交换区；都放不下就留着
+static bool vmm_evict(page_table_entry_t *pte)
+{
+    phys_addr_t phys = FRAME_TO_PHYS(pte->frame);
+    const void *data = (const void *)((uint32_t)phys + KERNEL_VIRT_OFFSET);
+    uint32_t avail;
+
+    // 文件页只撤映射，再访问时缺页从页缓存拿；页本身等没人映射了由页缓存丢掉
+    if (pmm_page(phys)->flags & PG_FILE) {
+        *pte = (page_table_entry_t){ 0 };
+        page_put(pmm_page(phys));
+        return true;
+    }
+
+    int handle = zram_store(data);
+    if (handle >= 0) {
+        avail = PTE_ZRAM;
+    } else if (swap_enabled() && (handle = swap_alloc()) >= 0) {
+        if (swap_write_page(handle, data) < 0) {
+            // 没写进去：槽还回去，页继续映射着
+            swap_free(handle);
+            return false;
+        }
+        avail = PTE_SWAP;
+    } else {
+        return false;
+    }
+
+    *pte = (page_table_entry_t){ 0 };
+    pte->avail = avail;
+    pte->frame = handle;
+    page_put(pmm_page(phys));
+    return true;
+}
+
+static uint32_t vmm_reclaim(uint32_t nr_pages)
+{
+    // 没人映射的页缓存页是干净的，不用写盘直接丢，先拿这些
+    uint32_t freed = page_cache_shrink(nr_pages);
+    if (freed >= nr_pages || !as_list) {
+        return freed;
+    }
+    if (!clock_as) {
+        clock_as = as_list;
+        clock_va = 0;
+    }
+
+    uint32_t scanned = 0, referenced = 0;
+    // 回到链表开头算一圈；第一圈清掉的 A 位要再转一圈才看得出来，最多转三次
+    uint32_t wraps = 0;
+    while (freed < nr_pages && wraps < 3) {
+        page_directory_entry_t *pde = &clock_as->pd->entries[PDE_INDEX(clock_va)];
+        if (!pde->present || pde->page_size) {
+            clock_va = (clock_va & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE;
+        } else {
+            page_table_entry_t *pte = &pde_table(pde)->pages[PTE_INDEX(clock_va)];
+            if (vmm_swap_candidate(pte)) {
+                scanned++;
+                if (pte->accessed) {
+                    referenced++;
+                    pte->accessed = 0;
+                    if (clock_as == current_as) {
+                        vmm_invlpg(clock_va);
+                    }
+                } else {
+                    bool file = (pmm_page(FRAME_TO_PHYS(pte->frame))->flags & PG_FILE) != 0;
+                    if (vmm_evict(pte)) {
+                        if (clock_as == current_as) {
+                            vmm_invlpg(clock_va);
+                        }
+                        VMSTAT_ADD(clock_as, pages_unmapped, 1);
+                        // 文件页撤了映射不等于腾出了页，最后统一从页缓存里丢
+                        freed += file ? 0 : 1;
+                    }
+                }
+            }
+            clock_va += PAGE_SIZE;
+        }
+
+        if (clock_va >= KERNEL_VIRT_OFFSET) {
+            clock_va = 0;
+            clock_as = clock_as->next;
+            if (!clock_as) {
+                clock_as = as_list;
+                wraps++;
+            }
+        }
+    }
+
+    swap_account_scan(scanned, referenced);
+    if (freed < nr_pages) {
+        freed += page_cache_shrink(nr_pages - freed);
+    }
+    return freed;
+}
+
+// 用户数据页（在 physmap 里，内核能直接读写）：空闲页不多了先回收一批，分不到就回收完再试一次
+phys_addr_t vmm_alloc_user_frame(bool zeroed)
+{
+    if (pmm_free_frames() < VMM_FREE_LOW) {
+        vmm_reclaim(VMM_RECLAIM_BATCH);
+    }
+
+    phys_addr_t phys = zeroed ? pmm_alloc_zeroed_frame()
+                              : pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+    if (phys || !vmm_reclaim(VMM_RECLAIM_BATCH)) {
+        return phys;
+    }
+    return zeroed ? pmm_alloc_zeroed_frame() : pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+}
+
+// 处理掉的缺页分三类记到 vmstat 里，处理不了的返回 -1
+enum {
+    VM_FAULT_MINOR,     // 页已经在内存里：COW、文件页（页缓存）
+    VM_FAULT_MAJOR,     // 要从 zram 或交换区读回来
+    VM_FAULT_ZERO,      // 共享零页、新的清零页、大页
+};
+
+// 换出去的页缺页：读回（或解压）一页新的，按区域现在的权限映射，交换槽的引用还掉
+static int vmm_fault_swap_in(uintptr_t va, const vm_area_t *vma, page_table_entry_t *pte)
+{
+    uint64_t t0 = rdtsc();
+    bool zram = (pte->avail & PTE_ZRAM) != 0;
+    uint32_t handle = pte->frame;
+
+    phys_addr_t phys = vmm_alloc_user_frame(false);
+    if (!phys) {
+        return -1;
+    }
+    void *page = (void *)((uint32_t)phys + KERNEL_VIRT_OFFSET);
+    if (zram) {
+        if (zram_load(handle, page) < 0) {
+            pmm_free_frame(phys);
+            return -1;
+        }
+        zram_free(handle);
+    } else {
+        // 读不回来：交换项留着，这次缺页失败（进程会被杀掉），不能把半页垃圾映射进去
+        if (swap_read_page(handle, page) < 0) {
+            pmm_free_frame(phys);
+            return -1;
+        }
+        swap_free(handle);
+    }
+    pmm_page(phys)->flags |= PG_ANON;
+
+    *pte = (page_table_entry_t){ 0 };
+    pte->frame   = phys >> 12;
+    pte->rw      = (vma->flags & VMM_RW) ? 1 : 0;
+    pte->user    = 1;
+    pte->present = 1;
+    vmm_invlpg(va);
+    VMSTAT_ADD(current_as, pages_mapped, 1);
+
+    if (zram) {
+        zram_account_fault((uint32_t)(rdtsc() - t0));
+    }
+    return VM_FAULT_MAJOR;
+}
+
+/*
+ * 写一个只读的已映射页，能处理的只有两种：
+ *   共享零页：换成自己的清零页（所在区域要可写）
+ *   COW 页：  别人还在用就复制一份，只剩自己用了就直接改回可写
+ */
+static int vmm_fault_write_protect(uintptr_t va)
+{
+    page_directory_entry_t *pde = vmm_pde(va);
+    if (!pde->present || pde->page_size) {
+        return -1;
+    }
+    page_table_entry_t *pte = &pde_table(pde)->pages[PTE_INDEX(va)];
+    if (!pte->present) {
+        return -1;
+    }
+
+    phys_addr_t old = FRAME_TO_PHYS(pte->frame);
+    int kind;
+
+    // mprotect 改成只读（或 PROT_NONE）的区域，COW 页也不能写
+    vm_area_t *vma = vmm_vma_find(current_as, va);
+    if (!vma || (vma->flags & (VMM_RW | VMM_USER)) != (VMM_RW | VMM_USER)) {
+        return -1;
+    }
+
+    if (zero_page && old == zero_page) {
+        phys_addr_t phys = vmm_alloc_user_frame(true);
+        if (!phys) {
+            return -1;
+        }
+        pmm_page(phys)->flags |= PG_ANON;
+        pte->frame = phys >> 12;
+        kind = VM_FAULT_ZERO;
+    } else if (pte->avail & PTE_COW) {
+        struct page *pg = pmm_page(old);
+        if (!pg || pg->refcount > 1) {
+            // 新页要能从 physmap 访问，直接从还映射着的用户地址拷过去
+            phys_addr_t phys = vmm_alloc_user_frame(false);
+            if (!phys) {
+                return -1;
+            }
+            kmemcpy((void *)((uint32_t)phys + KERNEL_VIRT_OFFSET), (const void *)va, PAGE_SIZE);
+            pmm_page(phys)->flags |= PG_ANON;
+            pte->frame = phys >> 12;
+            if (pg) {
+                page_put(pg);
+            }
+        }
+        pte->avail &= ~PTE_COW;
+        kind = VM_FAULT_MINOR;
+    } else {
+        return -1;
+    }
+
+    pde->rw = 1;
+    pte->rw = 1;
+    vmm_invlpg(va);
+    return kind;
+}
+
+/*
+ * 可写的匿名区域里，va 所在的整个对齐大页范围都在区域内、这段还没有页表时，
+ * 直接分一块物理连续的大页，用 PS=1 的 PDE 映射，省掉页表和大部分 TLB 缺失。
+ * 分不到连续内存就返回 -1，调用者退回 4 KiB 页。
+ */
+static int vmm_fault_huge(uintptr_t va, const vm_area_t *vma)
+{
+    uintptr_t start = va & ~(LARGE_PAGE_SIZE - 1);
+
+    if (vma->source || (vma->flags & (VMM_RW | VMM_USER)) != (VMM_RW | VMM_USER) ||
+        start < vma->start || vma->end - start < LARGE_PAGE_SIZE) {
+        return -1;
+    }
+    page_directory_entry_t *pde = vmm_pde(va);
+    if (pde->present) {
+        return -1;
+    }
+
+    // 要在 physmap 里才能直接清零
+    phys_addr_t phys = pmm_alloc_pages_zone(VMM_HUGE_ORDER, PMM_ZONE_NORMAL);
+    if (!phys) {
+        huge_stats.fallbacks++;
+        return -1;
+    }
+    pmm_zero_range(phys, LARGE_PAGE_SIZE);
+    for (uint32_t i = 0; i < VMM_HUGE_PAGES; i++) {
+        pmm_page(phys + i * PAGE_SIZE)->flags |= PG_ANON;
+    }
+
+    vmm_set_large_pde(pde, phys, VMM_PRESENT | vma->flags);
+    VMSTAT_ADD(current_as, pages_mapped, VMM_HUGE_PAGES);
+    huge_stats.mapped++;
+    huge_stats.faults++;
+    return 0;
+}
+
+// 返回 VM_FAULT_*，处理不了返回 -1
+static int vmm_fault(uintptr_t addr, uint32_t err)
+{
+    if (addr >= KERNEL_VIRT_OFFSET) {
+        return -1;
+    }
+
+    uintptr_t va = addr & ~(PAGE_SIZE - 1);
+    bool write = (err & PF_WRITE) != 0;
+
+    if (err & PF_PRESENT) {
+        return write ? vmm_fault_write_protect(va) : -1;
+    }
+
+    vm_area_t *vma = vmm_vma_find(current_as, addr);
+    if (!vma || !(vma->flags & VMM_USER)) {
+        return -1;
+    }
+    if (write && !(vma->flags & VMM_RW)) {
+        return -1;
+    }
+
+    page_directory_entry_t *pde = vmm_pde(va);
+    if (pde->present && !pde->page_size) {
+        page_table_entry_t *pte = &pde_table(pde)->pages[PTE_INDEX(va)];
+        if (vmm_pte_is_swap(pte)) {
+            return vmm_fault_swap_in(va, vma, pte);
+        }
+    }
+
+    // 文件映射：页来自页缓存，所有映射这一页的进程共享，只读
+    if (vma->source) {
+        phys_addr_t phys = vma->source->get_page(vma->source_data,
+                                                 vma->pgoff + (va - vma->start) / PAGE_SIZE);
+        if (!phys) {
+            return -1;
+        }
+        if (vmm_map_page(va, phys, VMM_PRESENT | (vma->flags & ~VMM_RW)) < 0) {
+            page_put(pmm_page(phys));
+            return -1;
+        }
+        return VM_FAULT_MINOR;
+    }
+
+    if (vmm_fault_huge(va, vma) == 0) {
+        return VM_FAULT_ZERO;
+    }
+
+    if (!write && vmm_zero_page()) {
+        if (vmm_map_page(va, zero_page, VMM_PRESENT | VMM_USER) < 0) {
+            return -1;
+        }
+        return VM_FAULT_ZERO;
+    }
+
+    phys_addr_t phys = vmm_alloc_user_frame(true);
+    if (!phys) {
+        return -1;
+    }
+    pmm_page(phys)->flags |= PG_ANON;
+    if (vmm_map_page(va, phys, VMM_PRESENT | vma->flags) < 0) {
+        pmm_free_frame(phys);
+        return -1;
+    }
+    return VM_FAULT_ZERO;
+}
+
+int vmm_handle_fault(uintptr_t addr, uint32_t err)
+{
+    int kind = vmm_fault(addr, err);
+
+    VMSTAT_ADD(current_as, faults, 1);
+    switch (kind) {
+    case VM_FAULT_MINOR: VMSTAT_ADD(current_as, faults_minor, 1); break;
+    case VM_FAULT_MAJOR: VMSTAT_ADD(current_as, faults_major, 1); break;
+    case VM_FAULT_ZERO:  VMSTAT_ADD(current_as, faults_zero, 1);  break;
+    default:             return -1;
+    }
+    return 0;
+}
+
+void vmm_get_vmstat(vmstat_t *global, vmstat_t *as)
+{
+    if (global) {
+        *global = vmstat_global;
+    }
+    if (as) {
+        *as = current_as->stat;
+    }
+}
+
+/*
+ * CR3 切换 microbenchmark：在两个地址空间之间来回切，每次切完读
+ * CR3_BENCH_TOUCH 个内核 4 KiB 页（内核镜像那一段），分别在打开和关掉
+ * CR4.PGE 的情况下测，报告每次“切换 + 访问”的平均 cycles。
+ */
+#define CR3_BENCH_ROUNDS 1000
+#define CR3_BENCH_TOUCH  32
+
+static uint32_t vmm_bench_switch(address_space_t *a, address_space_t *b)
+{
+    extern uint8_t _kernel_start;
+    volatile uint8_t *kbase = (volatile uint8_t *)((uint32_t)&_kernel_start + KERNEL_VIRT_OFFSET);
+
+    uint64_t t0 = rdtsc();
+    for (uint32_t r = 0; r < CR3_BENCH_ROUNDS; r++) {
+        vmm_as_switch((r & 1) ? b : a);
+        for (uint32_t i = 0; i < CR3_BENCH_TOUCH; i++) {
+            (void)kbase[i * PAGE_SIZE];
+        }
+    }
+    uint32_t cycles = (uint32_t)(rdtsc() - t0);
+    return cycles / CR3_BENCH_ROUNDS;
+}
+
+void vmm_bench(void)
+{
+    address_space_t *old = current_as;
+    address_space_t *a = vmm_as_create();
+    address_space_t *b = vmm_as_create();
+    if (!a || !b) {
+        kprintf("vmm bench: vmm_as_create failed\n");
+        vmm_as_destroy(a);
+        vmm_as_destroy(b);
+        return;
+    }
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+
+    uint32_t global = vmm_bench_switch(a, b);
+    asm volatile("mov %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+    uint32_t flush_all = vmm_bench_switch(a, b);
+    asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+
+    kprintf("vmm bench: cr3 switch + %u kernel page reads: %u cycles global, %u cycles non-global\n",
+            CR3_BENCH_TOUCH, global, flush_all);
+
+    vmm_as_switch(old);
+    vmm_as_destroy(a);
+    vmm_as_destroy(b);
+
+    vmm_bench_unmap();
+}
+
+int vmm_map_region(uintptr_t vstart,
+                   uintptr_t vend,
+                   uintptr_t pstart,
+                   uint32_t flags)
+{
+    // 向下对齐起点，向上对齐终点
+    uintptr_t va = vstart & ~(PAGE_SIZE - 1);
+    uintptr_t end = (vend + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    while (va < end) {
+        phys_addr_t phys;
+        if (pstart)
+            phys = pstart + (va - vstart);
+        else
+            phys = pmm_alloc_frame();  // 直接返回物理地址
+
+        if (!phys)
+            return -1;
+
+        if (vmm_map_page(va, phys, flags) < 0)
+            return -1;
+
+        va += PAGE_SIZE;
+    }
+    return 0;
+}
+
+int vmm_unmap_region(uintptr_t vstart,
+                     uintptr_t vend,
+                     bool free_frames)
+{
+    // 没映射的页直接跳过；一次冲刷 TLB，顺便回收清空的页表
+    tlb_gather_t tlb;
+    tlb_gather_init(&tlb);
+    vmm_unmap_range_gather(&tlb, vstart, vend, free_frames);
+    tlb_gather_flush(&tlb);
     return 0;
 }
 
@@ -302,21 +2017,21 @@ int vmm_unmap_region(uintptr_t vstart,
 
 #define ADDR_OFFSET        0xC0000000U
 // 页目录中重新映射到高端内核的索引：
-#define KERNEL_PD_INDEX    (ADDR_OFFSET >> 22)
+#define KERNEL_PD_INDEX    PDE_INDEX(ADDR_OFFSET)
 
-extern uint32_t boot_page_table1  [PAGE_TABLE_ENTRIES];
+extern page_table_entry_t boot_page_table1[PAGE_TABLE_ENTRIES];
 
 // /**
 //  * @brief  打印给定虚拟地址在 boot page directory + table1 中的 PDE/PTE 及物理页帧信息
 //  * @param  va  要查询的虚拟地址
 //  */
 void dump_boot_pte(uint32_t va) {
-    uint32_t pdi    = va >> 22;            // bits 31–22
-    uint32_t pti    = (va >> 12) & 0x3FF;  // bits 21–12
+    uint32_t pdi    = PDE_INDEX(va);       // bits 31–22（PAE: 31–21）
+    uint32_t pti    = PTE_INDEX(va);       // bits 21–12（PAE: 20–12）
 
     // 1) 读 PDE
     page_directory_entry_t pde = boot_page_directory.entries[pdi];
-    kprintf("VA=0x%x  PDE[%u] = 0x%x\n", va, pdi, pde);
+    kprintf("VA=0x%x  PDE[%u] frame = 0x%x\n", va, pdi, (uint32_t)pde.frame);
     if (!pde.present) {
         kprintf("PDE not mapped!\n");
         return;
@@ -329,18 +2044,18 @@ void dump_boot_pte(uint32_t va) {
     }
 
     // 3) 小页：从 PDE 提取页表物理地址
-    uint32_t pt_phys = ((uint32_t)pde.frame) << 12;
+    uint32_t pt_phys = (uint32_t)FRAME_TO_PHYS(pde.frame);
     // 转成内核虚拟地址（高端映射）
     uint32_t pt_virt = pt_phys + KERNEL_VIRT_OFFSET;
     uint32_t *pt     = (uint32_t *)pt_virt; // 指向 PTE[0]
     kprintf("pt adress: 0x%x \n", pt);
     kprintf("page table1: 0x%x \n", boot_page_table1);
 
-    uint32_t pte = boot_page_table1[pti];
-    kprintf("PTE: 0x%x \n",pte);
-    if (pte & 1) {
+    page_table_entry_t pte = boot_page_table1[pti];
+    kprintf("PTE frame: 0x%x \n", (uint32_t)pte.frame);
+    if (pte.present) {
         kprintf("PTE Mapped !!!!!!!!!!!\n");
-        kprintf("  PTE[%u] = 0x%x\n", pdi, pte);
+        kprintf("  PTE[%u] frame = 0x%x\n", pdi, (uint32_t)pte.frame);
         return;
     }
     kprintf("PTE no MAPPED!\n");
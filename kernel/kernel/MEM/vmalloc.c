@@ -0,0 +1,339 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <libk/stdio.h>
+
+#include "kernel/vmalloc.h"
+#include "kernel/avl.h"
+#include "kernel/pmm.h"
+#include "kernel/io.h"
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+#define PAGE_SIZE          0x1000U
+
+/*
+ * 区间描述符：空闲的挂在 free_tree（按地址，释放时找左右邻居合并）和
+ * 按大小分级的链表 free_class[]（分配时按级别找）上；已分配的挂在 busy_tree 上，
+ * 释放时按地址找回大小。
+ *
+ * 第 c 级放 npages 在 [2^c, 2^(c+1)) 的空闲区间：要 n 页时先在
+ * floor(log2 n) 级里逐个找放得下的，找不到再看更高的级别
+ * （里面的区间一定够大，取链表头就行）。
+ */
+#define VMALLOC_CLASSES 16
+
+typedef struct vm_range {
+    avl_node_t node;
+    struct vm_range *next;          // 同级空闲链表 / 描述符空闲链表
+    struct vm_range *prev;
+    uintptr_t start;
+    uint32_t  npages;               // 已分配的区间包含保护页
+    uint32_t  flags;
+} vm_range_t;
+
+static avl_tree_t free_tree = AVL_TREE_INIT;
+static avl_tree_t busy_tree = AVL_TREE_INIT;
+static vm_range_t *free_class[VMALLOC_CLASSES];
+
+static vmalloc_stats_t stats;
+
+/*
+ * 描述符不能用 kmalloc 分配（kmalloc 自己要靠 vmalloc 扩堆），
+ * 先用一小块静态的，不够了直接从 physmap 拿整页切。
+ */
+#define VMALLOC_STATIC_RANGES 64
+
+static vm_range_t static_ranges[VMALLOC_STATIC_RANGES];
+static vm_range_t *range_freelist;
+
+static void range_pool_add(vm_range_t *r, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        r[i].next = range_freelist;
+        range_freelist = &r[i];
+    }
+}
+
+static vm_range_t *range_new(void)
+{
+    if (!range_freelist) {
+        phys_addr_t phys = pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+        if (!phys) {
+            return NULL;
+        }
+        range_pool_add((vm_range_t *)((uint32_t)phys + KERNEL_VIRT_OFFSET),
+                       PAGE_SIZE / sizeof(vm_range_t));
+    }
+    vm_range_t *r = range_freelist;
+    range_freelist = r->next;
+    return r;
+}
+
+static void range_release(vm_range_t *r)
+{
+    r->next = range_freelist;
+    range_freelist = r;
+}
+
+static int range_cmp(const avl_node_t *a, const avl_node_t *b)
+{
+    uintptr_t sa = avl_entry(a, vm_range_t, node)->start;
+    uintptr_t sb = avl_entry(b, vm_range_t, node)->start;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+static inline uint32_t floor_log2(uint32_t n)
+{
+    uint32_t r;
+    asm("bsr %1, %0" : "=r"(r) : "rm"(n));
+    return r;
+}
+
+static inline uint32_t range_class(uint32_t npages)
+{
+    uint32_t c = floor_log2(npages);
+    return c < VMALLOC_CLASSES ? c : VMALLOC_CLASSES - 1;
+}
+
+static void class_insert(vm_range_t *r)
+{
+    uint32_t c = range_class(r->npages);
+    r->prev = NULL;
+    r->next = free_class[c];
+    if (r->next) {
+        r->next->prev = r;
+    }
+    free_class[c] = r;
+}
+
+static void class_remove(vm_range_t *r)
+{
+    if (r->prev) {
+        r->prev->next = r->next;
+    } else {
+        free_class[range_class(r->npages)] = r->next;
+    }
+    if (r->next) {
+        r->next->prev = r->prev;
+    }
+}
+
+static void free_insert(vm_range_t *r)
+{
+    avl_insert(&free_tree, &r->node, range_cmp);
+    class_insert(r);
+    stats.nr_free_ranges++;
+}
+
+static void free_remove(vm_range_t *r)
+{
+    avl_remove(&free_tree, &r->node);
+    class_remove(r);
+    stats.nr_free_ranges--;
+}
+
+void vmalloc_init(void)
+{
+    range_freelist = NULL;
+    range_pool_add(static_ranges, VMALLOC_STATIC_RANGES);
+
+    vm_range_t *all = range_new();
+    all->start  = VMALLOC_START;
+    all->npages = (VMALLOC_END - VMALLOC_START) / PAGE_SIZE;
+    all->flags  = 0;
+
+    stats.total_pages = all->npages;
+    stats.free_pages  = all->npages;
+    free_insert(all);
+}
+
+static vm_range_t *find_fit(uint32_t npages)
+{
+    uint32_t lo = range_class(npages);
+
+    // 同一级里先找一个放得下的，刚释放的区间优先被重用，大区间不被切碎
+    for (vm_range_t *r = free_class[lo]; r; r = r->next) {
+        if (r->npages >= npages) {
+            return r;
+        }
+    }
+    for (uint32_t c = lo + 1; c < VMALLOC_CLASSES; c++) {
+        if (free_class[c]) {
+            return free_class[c];
+        }
+    }
+    return NULL;
+}
+
+uintptr_t vmalloc_va_alloc(uint32_t npages, uint32_t flags)
+{
+    uint32_t total = npages + ((flags & VMALLOC_GUARD) ? 1 : 0);
+    if (npages == 0 || total > stats.total_pages) {
+        stats.fail_count++;
+        return 0;
+    }
+
+    vm_range_t *r = find_fit(total);
+    vm_range_t *area = r ? range_new() : NULL;
+    if (!area) {
+        stats.fail_count++;
+        return 0;
+    }
+
+    // 从空闲区间的开头切；剩下的部分起点变大，在树里的位置不变
+    area->start  = r->start;
+    area->npages = total;
+    area->flags  = flags & VMALLOC_GUARD;
+
+    if (r->npages == total) {
+        free_remove(r);
+        range_release(r);
+    } else {
+        class_remove(r);
+        r->start  += total * PAGE_SIZE;
+        r->npages -= total;
+        class_insert(r);
+    }
+
+    avl_insert(&busy_tree, &area->node, range_cmp);
+    stats.nr_areas++;
+    stats.used_pages += total;
+    stats.free_pages -= total;
+    stats.guard_pages += total - npages;
+    stats.alloc_count++;
+    return area->start;
+}
+
+uint32_t vmalloc_va_free(uintptr_t va)
+{
+    vm_range_t *area = NULL;
+    for (avl_node_t *n = busy_tree.root; n; ) {
+        vm_range_t *r = avl_entry(n, vm_range_t, node);
+        if (va == r->start) {
+            area = r;
+            break;
+        }
+        n = va < r->start ? n->left : n->right;
+    }
+    if (!area) {
+        kprintf("vmalloc: free of unknown area 0x%x\n", va);
+        return 0;
+    }
+
+    avl_remove(&busy_tree, &area->node);
+    uint32_t guard = (area->flags & VMALLOC_GUARD) ? 1 : 0;
+    stats.nr_areas--;
+    stats.used_pages  -= area->npages;
+    stats.free_pages  += area->npages;
+    stats.guard_pages -= guard;
+    stats.free_count++;
+
+    uint32_t npages = area->npages - guard;
+
+    // 找地址上左右相邻的空闲区间，能接上的就合并
+    vm_range_t *prev = NULL, *next = NULL;
+    for (avl_node_t *n = free_tree.root; n; ) {
+        vm_range_t *r = avl_entry(n, vm_range_t, node);
+        if (r->start < area->start) {
+            prev = r;
+            n = n->right;
+        } else {
+            next = r;
+            n = n->left;
+        }
+    }
+
+    uintptr_t end = area->start + area->npages * PAGE_SIZE;
+    if (next && next->start == end) {
+        free_remove(next);
+        area->npages += next->npages;
+        range_release(next);
+    }
+    if (prev && prev->start + prev->npages * PAGE_SIZE == area->start) {
+        // 并进前一个区间：起点不变，只改大小和级别
+        class_remove(prev);
+        prev->npages += area->npages;
+        class_insert(prev);
+        range_release(area);
+    } else {
+        area->flags = 0;
+        free_insert(area);
+    }
+
+    return npages;
+}
+
+void vmalloc_get_stats(vmalloc_stats_t *out)
+{
+    *out = stats;
+
+    out->largest_free = 0;
+    for (int c = VMALLOC_CLASSES - 1; c >= 0 && !out->largest_free; c--) {
+        for (vm_range_t *r = free_class[c]; r; r = r->next) {
+            if (r->npages > out->largest_free) {
+                out->largest_free = r->npages;
+            }
+        }
+    }
+}
+
+void vmalloc_dump(void)
+{
+    vmalloc_stats_t s;
+    vmalloc_get_stats(&s);
+
+    kprintf("vmalloc: 0x%x-0x%x, %u/%u pages used (%u guard), %u areas\n",
+            VMALLOC_START, VMALLOC_END, s.used_pages, s.total_pages,
+            s.guard_pages, s.nr_areas);
+    kprintf("vmalloc: %u free ranges, largest %u pages; %u allocs %u frees %u fails\n",
+            s.nr_free_ranges, s.largest_free, s.alloc_count, s.free_count, s.fail_count);
+}
+
+/*
+ * churn microbenchmark：VMALLOC_BENCH_SLOTS 个槽位随机地分配/释放
+ * 1-64 页的区间（一半带保护页），最后全部释放，
+ * 报告每次操作的平均 cycles，并检查空闲 VA 是否合并回开始前的样子
+ * （空闲页数、空闲区间数、最大区间都不变），打印 PASS/FAIL。
+ */
+#define VMALLOC_BENCH_SLOTS 64
+#define VMALLOC_BENCH_OPS   4096
+
+void vmalloc_bench(void)
+{
+    static uintptr_t slot[VMALLOC_BENCH_SLOTS];
+    uint32_t seed = 12345;
+    vmalloc_stats_t before, after;
+
+    vmalloc_get_stats(&before);
+
+    uint64_t t0 = rdtsc();
+    for (uint32_t i = 0; i < VMALLOC_BENCH_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t k = (seed >> 16) % VMALLOC_BENCH_SLOTS;
+        if (slot[k]) {
+            vmalloc_va_free(slot[k]);
+            slot[k] = 0;
+        } else {
+            uint32_t n = 1 + ((seed >> 8) & 63);
+            slot[k] = vmalloc_va_alloc(n, (seed & 1) ? VMALLOC_GUARD : 0);
+        }
+    }
+    uint32_t cycles = (uint32_t)(rdtsc() - t0) / VMALLOC_BENCH_OPS;
+
+    for (uint32_t k = 0; k < VMALLOC_BENCH_SLOTS; k++) {
+        if (slot[k]) {
+            vmalloc_va_free(slot[k]);
+            slot[k] = 0;
+        }
+    }
+    vmalloc_get_stats(&after);
+
+    kprintf("vmalloc bench: %u ops, %u cycles/op\n", VMALLOC_BENCH_OPS, cycles);
+    bool merged = after.free_pages == before.free_pages &&
+                  after.nr_free_ranges == before.nr_free_ranges &&
+                  after.largest_free == before.largest_free;
+    kprintf("vmalloc bench: free pages %u -> %u, free ranges %u -> %u, largest %u -> %u: %s\n",
+            before.free_pages, after.free_pages,
+            before.nr_free_ranges, after.nr_free_ranges,
+            before.largest_free, after.largest_free, merged ? "PASS" : "FAIL");
+}
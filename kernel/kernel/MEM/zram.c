@@ -0,0 +1,447 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <libk/string.h>
+
+#include "kernel/zram.h"
+#include "kernel/pmm.h"
+
+#define KERNEL_VIRT_OFFSET 0xC0000000U
+#define PAGE_SIZE          0x1000U
+
+/*
+ * 压缩格式（LZ4 风格）：一串 sequence，每个 sequence 是
+ *   token（高 4 位字面量长度，低 4 位匹配长度 - 4；15 表示后面还有长度字节，
+ *          每个 255 继续，最后一个 < 255）
+ *   字面量
+ *   2 字节小端偏移 + 匹配长度的扩展字节
+ * 最后一个 sequence 只有字面量，解压读完字面量正好到结尾就停。
+ */
+#define LZ_MIN_MATCH   4
+#define LZ_LAST_LITS   5            // 最后几个字节总是当字面量，找匹配时不用越界
+#define LZ_HASH_BITS   10
+
+typedef uint32_t __attribute__((may_alias, aligned(1))) lz_u32;
+
+static uint16_t lz_table[1 << LZ_HASH_BITS];   // 哈希 -> 上次出现的位置
+
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    return *(const lz_u32 *)p;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static uint8_t *lz_put_len(uint8_t *op, uint32_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// 一个 sequence：[anchor, anchor + lit) 的字面量，再跟一个匹配（mlen 为 0 表示没有）
+static uint8_t *lz_put_seq(uint8_t *op, uint8_t *oend, const uint8_t *anchor,
+                           uint32_t lit, uint32_t off, uint32_t mlen)
+{
+    // 最坏情况：token + 长度字节 + 字面量 + 偏移
+    if ((uint32_t)(oend - op) < 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1) {
+        return NULL;
+    }
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+    if (lit >= 15) {
+        op = lz_put_len(op, lit - 15);
+    }
+    for (uint32_t i = 0; i < lit; i++) {
+        *op++ = anchor[i];
+    }
+
+    if (mlen) {
+        uint32_t ml = mlen - LZ_MIN_MATCH;
+        *op++ = (uint8_t)off;
+        *op++ = (uint8_t)(off >> 8);
+        *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+        if (ml >= 15) {
+            op = lz_put_len(op, ml - 15);
+        }
+    }
+    return op;
+}
+
+// 压缩 n 字节（n <= 64 KiB），输出超过 cap 返回 0
+static uint32_t lz_compress(const uint8_t *src, uint32_t n, uint8_t *dst, uint32_t cap)
+{
+    const uint8_t *ip     = src;
+    const uint8_t *anchor = src;
+    const uint8_t *end    = src + n;
+    const uint8_t *mlimit = n > LZ_LAST_LITS ? end - LZ_LAST_LITS : src;
+    uint8_t *op   = dst;
+    uint8_t *oend = dst + cap;
+
+    kmemset(lz_table, 0, sizeof(lz_table));
+
+    while (ip + LZ_MIN_MATCH <= mlimit) {
+        uint32_t seq = lz_read32(ip);
+        uint32_t h   = lz_hash(seq);
+        const uint8_t *ref = src + lz_table[h];
+        lz_table[h] = (uint16_t)(ip - src);
+
+        // 表里初始是 0，指向开头，所以一定要比较内容
+        if (ref >= ip || lz_read32(ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        const uint8_t *m = ip + LZ_MIN_MATCH;
+        const uint8_t *r = ref + LZ_MIN_MATCH;
+        while (m < mlimit && *m == *r) {
+            m++;
+            r++;
+        }
+
+        op = lz_put_seq(op, oend, anchor, (uint32_t)(ip - anchor),
+                        (uint32_t)(ip - ref), (uint32_t)(m - ip));
+        if (!op) {
+            return 0;
+        }
+        ip = anchor = m;
+    }
+
+    op = lz_put_seq(op, oend, anchor, (uint32_t)(end - anchor), 0, 0);
+    return op ? (uint32_t)(op - dst) : 0;
+}
+
+// 解压到 dst，返回解出的字节数；输入坏了或超过 cap 返回 -1
+static int lz_decompress(const uint8_t *src, uint32_t n, uint8_t *dst, uint32_t cap)
+{
+    const uint8_t *ip   = src;
+    const uint8_t *iend = src + n;
+    uint8_t *op   = dst;
+    uint8_t *oend = dst + cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        uint32_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > (uint32_t)(iend - ip) || lit > (uint32_t)(oend - op)) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < lit; i++) {
+            *op++ = *ip++;
+        }
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        uint32_t off = ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+
+        uint32_t ml = token & 15;
+        if (ml == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                ml += b;
+            } while (b == 255);
+        }
+        ml += LZ_MIN_MATCH;
+        if (off == 0 || off > (uint32_t)(op - dst) || ml > (uint32_t)(oend - op)) {
+            return -1;
+        }
+        // 偏移可能比长度短（重复的模式），只能逐字节拷
+        const uint8_t *r = op - off;
+        while (ml--) {
+            *op++ = *r++;
+        }
+    }
+    return (int)(op - dst);
+}
+
+/*
+ * 池：压缩数据按 32 字节分级，每级一串池页，池页切成等长的块。
+ * 页头放在页开头，块从 ZRAM_PAGE_HDR 开始。还有空块的页挂在本级的链表上，
+ * 页里的块全部释放后整页还给 PMM。池页都在 physmap 里。
+ */
+#define ZRAM_CLASS_SHIFT 5
+#define ZRAM_NR_CLASSES  (ZRAM_MAX_COMPRESSED >> ZRAM_CLASS_SHIFT)
+#define ZRAM_PAGE_HDR    32U
+
+_Static_assert((PAGE_SIZE - ZRAM_PAGE_HDR) / ZRAM_MAX_COMPRESSED >= 2,
+               "a pool page must hold at least two of the largest objects");
+
+typedef struct zram_free_obj {
+    struct zram_free_obj *next;
+} zram_free_obj_t;
+
+typedef struct zram_pool_page {
+    struct zram_pool_page *prev;
+    struct zram_pool_page *next;
+    zram_free_obj_t *free;          // 页里的空块
+    uint16_t cls;
+    uint16_t used;
+} zram_pool_page_t;
+
+_Static_assert(sizeof(zram_pool_page_t) <= ZRAM_PAGE_HDR, "pool page header too big");
+
+static zram_pool_page_t *pool_partial[ZRAM_NR_CLASSES];
+
+// 句柄表：len 为 0 表示同值页，value 是那个 32 位值；否则 data 指向池里的块
+typedef struct {
+    union {
+        void    *data;
+        uint32_t value;
+    };
+    uint16_t len;
+    uint16_t refs;                  // 0 = 空闲
+} zram_entry_t;
+
+static zram_entry_t zram_table[ZRAM_MAX_PAGES];
+static uint32_t zram_hint;
+static uint8_t  zram_buf[ZRAM_MAX_COMPRESSED];
+static zram_stats_t stats;
+static uint32_t pool_pages;
+
+static uint32_t zram_class_size(uint32_t cls)
+{
+    return (cls + 1) << ZRAM_CLASS_SHIFT;
+}
+
+static void pool_unlink(zram_pool_page_t *pp)
+{
+    if (pp->prev) {
+        pp->prev->next = pp->next;
+    } else {
+        pool_partial[pp->cls] = pp->next;
+    }
+    if (pp->next) {
+        pp->next->prev = pp->prev;
+    }
+    pp->prev = pp->next = NULL;
+}
+
+static void pool_push(zram_pool_page_t *pp)
+{
+    pp->prev = NULL;
+    pp->next = pool_partial[pp->cls];
+    if (pp->next) {
+        pp->next->prev = pp;
+    }
+    pool_partial[pp->cls] = pp;
+}
+
+static void *pool_alloc(uint32_t len)
+{
+    uint32_t cls = (len - 1) >> ZRAM_CLASS_SHIFT;
+    zram_pool_page_t *pp = pool_partial[cls];
+
+    if (!pp) {
+        if (pool_pages * PAGE_SIZE >= ZRAM_POOL_MAX_BYTES) {
+            return NULL;
+        }
+        phys_addr_t phys = pmm_alloc_frame_below(PMM_DIRECT_LIMIT);
+        if (!phys) {
+            return NULL;
+        }
+        pool_pages++;
+
+        pp = (zram_pool_page_t *)((uint32_t)phys + KERNEL_VIRT_OFFSET);
+        pp->cls  = (uint16_t)cls;
+        pp->used = 0;
+        pp->free = NULL;
+        uint32_t size = zram_class_size(cls);
+        uint8_t *base = (uint8_t *)pp + ZRAM_PAGE_HDR;
+        for (uint32_t i = (PAGE_SIZE - ZRAM_PAGE_HDR) / size; i > 0; i--) {
+            zram_free_obj_t *obj = (zram_free_obj_t *)(base + (i - 1) * size);
+            obj->next = pp->free;
+            pp->free  = obj;
+        }
+        pool_push(pp);
+    }
+
+    zram_free_obj_t *obj = pp->free;
+    pp->free = obj->next;
+    pp->used++;
+    if (!pp->free) {
+        pool_unlink(pp);
+    }
+    return obj;
+}
+
+static void pool_free(void *ptr)
+{
+    zram_pool_page_t *pp = (zram_pool_page_t *)((uint32_t)ptr & ~(PAGE_SIZE - 1));
+    bool was_full = pp->free == NULL;
+
+    zram_free_obj_t *obj = ptr;
+    obj->next = pp->free;
+    pp->free  = obj;
+    pp->used--;
+
+    if (pp->used == 0) {
+        if (!was_full) {
+            pool_unlink(pp);
+        }
+        pmm_free_frame((uint32_t)pp - KERNEL_VIRT_OFFSET);
+        pool_pages--;
+    } else if (was_full) {
+        pool_push(pp);
+    }
+}
+
+static int zram_alloc_handle(void)
+{
+    for (uint32_t i = 0; i < ZRAM_MAX_PAGES; i++) {
+        uint32_t h = zram_hint + i;
+        if (h >= ZRAM_MAX_PAGES) {
+            h -= ZRAM_MAX_PAGES;
+        }
+        if (!zram_table[h].refs) {
+            zram_hint = h + 1;
+            return (int)h;
+        }
+    }
+    return -1;
+}
+
+// 整页都是同一个 32 位值（大多是全零）
+static bool zram_same_filled(const uint32_t *page, uint32_t *value)
+{
+    for (uint32_t i = 1; i < PAGE_SIZE / 4; i++) {
+        if (page[i] != page[0]) {
+            return false;
+        }
+    }
+    *value = page[0];
+    return true;
+}
+
+int zram_store(const void *page)
+{
+    int h = zram_alloc_handle();
+    if (h < 0) {
+        stats.pool_full++;
+        return -1;
+    }
+    zram_entry_t *e = &zram_table[h];
+
+    uint32_t value;
+    if (zram_same_filled(page, &value)) {
+        e->value = value;
+        e->len   = 0;
+        e->refs  = 1;
+        stats.same_pages++;
+    } else {
+        uint32_t len = lz_compress(page, PAGE_SIZE, zram_buf, ZRAM_MAX_COMPRESSED);
+        if (!len) {
+            stats.rejected++;
+            return -1;
+        }
+        void *data = pool_alloc(len);
+        if (!data) {
+            stats.pool_full++;
+            return -1;
+        }
+        kmemcpy(data, zram_buf, len);
+        e->data = data;
+        e->len  = (uint16_t)len;
+        e->refs = 1;
+        stats.compr_bytes += len;
+    }
+
+    stats.stored_pages++;
+    stats.stores++;
+    return h;
+}
+
+int zram_load(uint32_t handle, void *page)
+{
+    if (handle >= ZRAM_MAX_PAGES || !zram_table[handle].refs) {
+        return -1;
+    }
+    zram_entry_t *e = &zram_table[handle];
+
+    stats.loads++;
+    if (e->len == 0) {
+        uint32_t *p = page;
+        for (uint32_t i = 0; i < PAGE_SIZE / 4; i++) {
+            p[i] = e->value;
+        }
+        return 0;
+    }
+    return lz_decompress(e->data, e->len, page, PAGE_SIZE) == (int)PAGE_SIZE ? 0 : -1;
+}
+
+void zram_dup(uint32_t handle)
+{
+    if (handle < ZRAM_MAX_PAGES && zram_table[handle].refs) {
+        zram_table[handle].refs++;
+    }
+}
+
+void zram_free(uint32_t handle)
+{
+    if (handle >= ZRAM_MAX_PAGES || !zram_table[handle].refs) {
+        return;
+    }
+    zram_entry_t *e = &zram_table[handle];
+    if (--e->refs) {
+        return;
+    }
+
+    if (e->len == 0) {
+        stats.same_pages--;
+    } else {
+        pool_free(e->data);
+        stats.compr_bytes -= e->len;
+    }
+    stats.stored_pages--;
+    if (handle < zram_hint) {
+        zram_hint = handle;
+    }
+}
+
+void zram_account_fault(uint32_t cycles)
+{
+    uint32_t b = 0;
+    while (b < ZRAM_LAT_BUCKETS - 1 && cycles >= (512U << b)) {
+        b++;
+    }
+    stats.fault_lat_hist[b]++;
+    if (cycles > stats.fault_max_cycles) {
+        stats.fault_max_cycles = cycles;
+    }
+}
+
+void zram_get_stats(zram_stats_t *st)
+{
+    *st = stats;
+    st->pool_bytes = pool_pages * PAGE_SIZE;
+
+    // 同值页不占池空间，只按压缩过的页算；按 16 字节为单位避免溢出
+    uint32_t compr_pages = stats.stored_pages - stats.same_pages;
+    st->ratio_x100 = stats.compr_bytes
+                   ? compr_pages * (PAGE_SIZE / 16) * 100 / (stats.compr_bytes / 16 + 1)
+                   : 0;
+}
@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <libk/stdio.h>
+
+#include "kernel/process.h"
+#include "kernel/kmalloc.h"
+#include "kernel/pmm.h"
+
+#define INT80_LEN     2         // int $0x80 的指令长度
+#define USER_DS       0x23
+// 空闲循环的栈顶离 stack_top 留一点：键盘中断从 ring 0 打断它时 CPU 不压 esp/ss，
+// 换进用户态的帧后 useresp/ss 会写在中断帧上面
+#define IDLE_STACK_PAD 16
+
+extern uint8_t stack_top;
+
+// 第一个用户程序（shell）
+static process_t init_process = { .pid = 1 };
+static process_t *current = &init_process;
+static uint32_t next_pid = 2;
+
+process_t *process_current(void)
+{
+    return current;
+}
+
+int process_fork(registers_t *regs)
+{
+    process_t *child = kmalloc(sizeof(*child));
+    if (!child) {
+        return -1;
+    }
+
+    // 只复制页表，数据页写时复制
+    address_space_t *as = vmm_as_fork();
+    if (!as) {
+        kfree(child);
+        return -1;
+    }
+
+    child->pid    = next_pid++;
+    child->parent = current;
+    child->as     = NULL;
+
+    // 父进程停在这里，等子进程 exit 后从 fork 返回子进程 pid
+    current->as    = vmm_as_current();
+    current->frame = *regs;
+    current->frame.eax = child->pid;
+    user_heap_save(&current->heap);
+
+    current = child;
+    vmm_as_switch(as);
+    regs->eax = 0;
+    return child->pid;
+}
+
+int process_exit(registers_t *regs, int status)
+{
+    process_t *child = current;
+    process_t *parent = child->parent;
+    if (!parent) {
+        return -1;
+    }
+
+    // 子进程可能 exec 过，要释放的是它现在的地址空间
+    address_space_t *as = vmm_as_current();
+    vmm_as_switch(parent->as);
+    vmm_as_destroy(as);
+
+    user_heap_restore(&parent->heap);
+    *regs = parent->frame;
+    current = parent;
+
+    kprintf("process %u exited with status %d\n", child->pid, status);
+    kfree(child);
+    return 0;
+}
+
+static registers_t input_frame;     // 等输入的进程停下来时的 read 系统调用帧
+static bool        input_waiting;
+
+static void __attribute__((noreturn)) process_idle_loop(void)
+{
+    for (;;) {
+        // 补一页关着中断做：中断把进程接回用户态后就不会回到这里，不能丢下做了一半的页
+        __asm__ volatile ("cli" ::: "memory");
+        if (pmm_idle()) {
+            __asm__ volatile ("sti; nop" ::: "memory");   // 给挂着的中断一个窗口
+        } else {
+            __asm__ volatile ("sti; hlt" ::: "memory");
+        }
+    }
+}
+
+void process_idle(void)
+{
+    /*
+     * 系统调用的栈不要了，从内核栈顶重新开始。irq 的桩不换段寄存器，
+     * 从空闲循环 iret 回用户态时还是这里的 ds/es/fs/gs，所以先换成用户数据段（平坦段，ring 0 也能用）
+     */
+    __asm__ volatile ("movw %w0, %%ds\n\t"
+                      "movw %w0, %%es\n\t"
+                      "movw %w0, %%fs\n\t"
+                      "movw %w0, %%gs\n\t"
+                      "movl %1, %%esp\n\t"
+                      "jmp *%2"
+                      :: "r"(USER_DS), "r"((uint32_t)&stack_top - IDLE_STACK_PAD),
+                         "r"(process_idle_loop)
+                      : "memory");
+    __builtin_unreachable();
+}
+
+void process_wait_input(const registers_t *regs)
+{
+    input_frame = *regs;
+    input_frame.eip -= INT80_LEN;
+    input_waiting = true;
+    process_idle();
+}
+
+void process_wake_input(registers_t *regs)
+{
+    if (!input_waiting) {
+        return;
+    }
+    input_waiting = false;
+    *regs = input_frame;
+}
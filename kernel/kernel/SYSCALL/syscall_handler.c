@@ -4,6 +4,15 @@
 #include <kernel/elf.h>
 #include <kernel/tty.h>
 #include <kernel/keyboard.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/registers.h>
+#include <kernel/process.h>
+#include <kernel/mman.h>
+#include <kernel/ext2_api.h>
+#include <kernel/swap.h>
+#include <kernel/zram.h>
+#include <kernel/kmalloc.h>
 
 #define USER_STACK_TOP 0xBFFFE000
 
@@ -15,25 +24,19 @@ enum {
     SYS_CLEAR   = 4,
     SYS_EXIT    = 5,
     SYS_EXEC    = 6,
+    SYS_MEMINFO = 7,
+    SYS_FORK    = 8,
+    SYS_MMAP    = 9,
+    SYS_MUNMAP  = 10,
+    SYS_MPROTECT = 11,
+    SYS_OPEN    = 12,
+    SYS_CLOSE   = 13,
+    SYS_SWAPINFO = 14,
+    SYS_HUGEINFO = 15,
+    SYS_VMSTAT  = 16,
+    SYS_KMPROF  = 17,
 };
 
-typedef struct registers {
-    uint32_t edi;         // Last pushed by PUSHAD (lowest memory address)
-    uint32_t esi;
-    uint32_t ebp;
-    uint32_t esp;         // Original ESP (pushed by PUSHAD)
-    uint32_t ebx;
-    uint32_t edx;
-    uint32_t ecx;
-    uint32_t eax;         // First pushed by PUSHAD (highest memory address)
-    uint32_t int_num;      // Manually pushed interrupt number (e.g., 32 for IRQ0)
-    uint32_t dummy_error; // Manually pushed dummy error code (e.g., 0)
-    uint32_t eip;
-    uint32_t cs;
-    uint32_t eflags;
-    uint32_t useresp;
-    uint32_t ss;
-} registers_t;
 
 
 void syscall_handler(registers_t *regs)
@@ -66,6 +69,12 @@ void syscall_handler(registers_t *regs)
             break;
 
         case SYS_READ: {
+            // ext2 文件：ext2_read 先读进块缓冲，ATA 传输完再拷进用户缓冲区
+            if (regs->ebx >= EXT2_USER_FD_BASE) {
+                regs->eax = (uint32_t)ext2_read((int)regs->ebx - EXT2_USER_FD_BASE,
+                                                (void *)regs->ecx, regs->edx);
+                break;
+            }
             if (regs->ebx != 0) {
                 regs->eax = (uint32_t)-1;
                 break;
@@ -77,6 +86,16 @@ void syscall_handler(registers_t *regs)
 
             while (read < count) {
                 int c = keyboard_getchar();
+                if (c < 0 && read == 0) {
+                    // 一个字符都还没有：进空闲循环等键盘中断，醒来后重新执行这次 read。
+                    // 关着中断再看一次，免得按键正好在这之间到了却没人叫醒
+                    __asm__ volatile ("cli" ::: "memory");
+                    if (!keyboard_has_input()) {
+                        process_wait_input(regs);
+                    }
+                    __asm__ volatile ("sti" ::: "memory");
+                    continue;
+                }
                 if (c < 0) {
                     break;
                 }
@@ -94,28 +113,127 @@ void syscall_handler(registers_t *regs)
             break;
 
         case SYS_EXIT:
-            kprintf("\nuser program exited with status %d\n", regs->ebx);
-            for (;;) {
-                __asm__ volatile ("hlt");
+            // fork 出来的子进程：回到停在 fork 里的父进程
+            if (process_exit(regs, (int)regs->ebx) == 0) {
+                break;
             }
+
+            kprintf("\nuser program exited with status %d\n", regs->ebx);
+            process_idle();
             break;
 
         case SYS_EXEC: {
             const char *path = (const char *)regs->ebx;
             elf_load_result_t res;
 
-            if (elf_load_from_file(path, &res) < 0) {
+            // 新程序在新的地址空间里，栈也是新的
+            if (elf_exec(path, USER_STACK_TOP, &res) < 0) {
                 regs->eax = (uint32_t)-1;
                 break;
             }
 
-            kmemset((void *)(USER_STACK_TOP - 0x1000), 0, 0x1000);
             regs->eip = res.entry;
             regs->useresp = USER_STACK_TOP;
             regs->eax = 0;
             break;
         }
 
+        case SYS_MEMINFO: {
+            pmm_stats_t *out = (pmm_stats_t *)regs->ebx;
+            if (!out) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+
+            pmm_get_stats(out);
+            regs->eax = 0;
+            break;
+        }
+
+        case SYS_FORK:
+            // 成功时父进程先停下，regs 已换成子进程的帧（eax = 0）
+            if (process_fork(regs) < 0) {
+                regs->eax = (uint32_t)-1;
+            }
+            break;
+
+        case SYS_MMAP:
+            regs->eax = (uint32_t)sys_mmap((const mmap_args_t *)regs->ebx);
+            break;
+
+        case SYS_MUNMAP:
+            regs->eax = (uint32_t)sys_munmap(regs->ebx, regs->ecx);
+            break;
+
+        case SYS_MPROTECT:
+            regs->eax = (uint32_t)sys_mprotect(regs->ebx, regs->ecx, regs->edx);
+            break;
+
+        case SYS_OPEN: {
+            int fd = ext2_open((const char *)regs->ebx);
+            regs->eax = fd < 0 ? (uint32_t)-1 : (uint32_t)(fd + EXT2_USER_FD_BASE);
+            break;
+        }
+
+        case SYS_CLOSE:
+            if (regs->ebx < EXT2_USER_FD_BASE) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            regs->eax = (uint32_t)ext2_close((int)regs->ebx - EXT2_USER_FD_BASE);
+            break;
+
+        case SYS_SWAPINFO: {
+            swap_stats_t *swap = (swap_stats_t *)regs->ebx;
+            zram_stats_t *zram = (zram_stats_t *)regs->ecx;
+            if (!swap || !zram) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+
+            swap_get_stats(swap);
+            zram_get_stats(zram);
+            regs->eax = 0;
+            break;
+        }
+
+        case SYS_HUGEINFO: {
+            vmm_huge_stats_t *out = (vmm_huge_stats_t *)regs->ebx;
+            if (!out) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+
+            vmm_get_huge_stats(out);
+            regs->eax = 0;
+            break;
+        }
+
+        case SYS_VMSTAT: {
+            vmstat_t *global = (vmstat_t *)regs->ebx;
+            vmstat_t *as     = (vmstat_t *)regs->ecx;
+            if (!global || !as) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+
+            vmm_get_vmstat(global, as);
+            regs->eax = 0;
+            break;
+        }
+
+        case SYS_KMPROF: {
+            kmalloc_prof_t *summary = (kmalloc_prof_t *)regs->ebx;
+            kmalloc_site_t *sites   = (kmalloc_site_t *)regs->ecx;
+            if (!summary || (!sites && regs->edx)) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+
+            regs->eax = (uint32_t)kmalloc_profile(summary, sites, regs->edx);
+            break;
+        }
+
         default:
             regs->eax = (uint32_t)-1;
             break;
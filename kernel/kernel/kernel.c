@@ -10,14 +10,20 @@
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <kernel/kha.h>
+#include <kernel/vmalloc.h>
+#include <kernel/pat.h>
+#include <kernel/slab.h>
 #include <kernel/kmalloc.h>
 #include <kernel/user_heap.h>
 #include <kernel/ata.h>
 #include <kernel/ext2.h>
 #include <kernel/ext2_api.h>
+#include <kernel/swap.h>
 #include <kernel/elf.h>
+#include <kernel/ksyms.h>
 #include <kernel/tss.h>
 
+#define KERNEL_VIRT_OFFSET 0xC0000000
 #define USER_STACK_TOP 0xBFFFE000
 #define VMM_PRESENT  (1<<0)
 #define VMM_RW       (1<<1)
@@ -46,14 +52,37 @@ void kernel_main(multiboot_info_t* mbd, uint32_t magic) {
 	kprintf("Initilizing Physical Memory Manager.................");
 	pmm_init(mbd , magic);
 	kprintf("done \n");
+#ifdef KERNEL_BENCH
+	pmm_bench();
+#endif
+
+	kprintf("Initilizing Kernel Symbols.................");
+	ksyms_init(mbd);
+	kprintf("done \n");
 
 	kprintf("Initilizing Virtual Memory Manager.................");
 	vmm_init();
 	kprintf("done \n");
 
+	kprintf("Initilizing PAT.................");
+	pat_init();
+	// 控制台显存只写不读，用 write-combining。physmap 里同一物理页还有个 WB 别名，
+	// 两种类型混着映射同一页结果是未定义的：别名没人用，直接拆掉
+	vmm_unmap_page(KERNEL_VIRT_OFFSET + (uint32_t)vmm_translate(terminal_vram()), false);
+	vmm_set_cache(terminal_vram(), 1, VMM_CACHE_WC);
+	kprintf("done \n");
+
 	kprintf("Initilizing Kernel Heap Allocator.................");
 	vmm_heap_init();
 	kprintf("done \n");
+#ifdef KERNEL_BENCH
+	vmm_bench();
+	vmalloc_bench();
+	vmalloc_dump();
+	pat_bench();
+	kmalloc_bench();
+	slab_bench();
+#endif
 
 	kprintf("Initilizing PIC.................");
 	PIC_remap(32, 40);
@@ -65,6 +94,13 @@ void kernel_main(multiboot_info_t* mbd, uint32_t magic) {
 	kprintf("Initilizing EXT2 File System.................");
 	ext2_init();
 	kprintf("done \n");
+#ifdef KERNEL_BENCH
+	kmem_cache_dump();
+#endif
+
+	kprintf("Initilizing Swap.................");
+	swap_init();
+	kprintf("done \n");
 
 	kprintf("Initilizing User Heap Allocator.................");
 	user_heap_init();
@@ -72,7 +108,7 @@ void kernel_main(multiboot_info_t* mbd, uint32_t magic) {
 
         kprintf("Loading User Programme.................");
         elf_load_result_t res;
-        int ret = elf_load_from_file("/shell", &res);
+        int ret = elf_exec("/shell", USER_STACK_TOP, &res);
         kprintf("elf_load ret=%d entry=0x%x heap=0x%x\n", ret, res.entry, res.heap_start);
         if (ret < 0) {
             kprintf("failed to load /shell\n");
@@ -83,14 +119,6 @@ void kernel_main(multiboot_info_t* mbd, uint32_t magic) {
         kprintf("\n");
         kprintf("done \n");
 
-	kprintf("Creating User Stack.................");
-	// 先给 user stack 映射一页
-	uintptr_t stack_page = USER_STACK_TOP - 0x1000;
-	uint32_t stack_phys = pmm_alloc_frame();
-	vmm_map_page(stack_page, stack_phys, VMM_PRESENT | VMM_RW | VMM_USER);
-	kmemset((void *)stack_page, 0, 0x1000);
-	kprintf("done \n");
-
 
 	// Enable interrupts globally.
 	kprintf("Enabling interrupts.................");
@@ -1,10 +1,16 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <zenos/kmprof.h>
+#include <zenos/meminfo.h>
 #include <zenos/readline.h>
+#include <zenos/swapinfo.h>
 #include <zenos/terminal.h>
+#include <zenos/vmstat.h>
 
 #define LINE_MAX 128
+#define KMPROF_MAX_SITES 16
 
 static void write_str(const char *s) {
     const char *p = s;
@@ -16,13 +22,150 @@ static void write_str(const char *s) {
     write(1, s, (unsigned)(p - s));
 }
 
+static void show_meminfo(void) {
+    zenos_meminfo_t info;
+
+    if (zenos_meminfo(&info) < 0) {
+        puts("meminfo: syscall failed");
+        return;
+    }
+
+    printf("total: %u KiB\n", info.total_frames * 4);
+    printf("used:  %u KiB\n", info.used_frames * 4);
+    printf("free:  %u KiB (largest run %u KiB, fragmentation %u%%)\n",
+           info.free_frames * 4, info.largest_free_run * 4, info.frag_score);
+    printf("allocs: %u frees: %u\n", info.alloc_count, info.free_count);
+    printf("zeroed pool: %u pages, %u hits, %u misses\n",
+           info.zero_pooled, info.zero_hits, info.zero_misses);
+
+    zenos_hugeinfo_t huge;
+    if (zenos_hugeinfo(&huge) == 0) {
+        printf("huge pages: %u mapped, %u faults, %u fallbacks, %u splits, %u freed\n",
+               huge.mapped, huge.faults, huge.fallbacks, huge.splits, huge.frees);
+    }
+
+    puts("pmm_alloc_frame latency (cycles):");
+    for (unsigned i = 0; i < ZENOS_LAT_BUCKETS; i++) {
+        if (info.alloc_lat_hist[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            printf("  <64: %u\n", info.alloc_lat_hist[i]);
+        } else if (i == ZENOS_LAT_BUCKETS - 1) {
+            printf("  >=%u: %u\n", 1u << (i + 5), info.alloc_lat_hist[i]);
+        } else {
+            printf("  %u-%u: %u\n", 1u << (i + 5), (1u << (i + 6)) - 1,
+                   info.alloc_lat_hist[i]);
+        }
+    }
+}
+
+static void show_swapinfo(void) {
+    zenos_swap_stats_t swap;
+    zenos_zram_stats_t zram;
+
+    if (zenos_swapinfo(&swap, &zram) < 0) {
+        puts("swapinfo: syscall failed");
+        return;
+    }
+
+    printf("swap: %u/%u KiB used, %u out, %u in\n",
+           swap.used_slots * 4, swap.total_slots * 4, swap.swap_outs, swap.swap_ins);
+    printf("clock: %u scanned, %u referenced, %u swap full, %u I/O errors\n",
+           swap.scanned, swap.referenced, swap.alloc_fail, swap.io_errors);
+    printf("zram: %u pages (%u same-filled), %u bytes compressed, pool %u KiB\n",
+           zram.stored_pages, zram.same_pages, zram.compr_bytes, zram.pool_bytes / 1024);
+    printf("zram: ratio %u.%u%u, %u stores, %u loads, %u rejected, %u pool full\n",
+           zram.ratio_x100 / 100, zram.ratio_x100 / 10 % 10, zram.ratio_x100 % 10,
+           zram.stores, zram.loads, zram.rejected, zram.pool_full);
+
+    printf("zram fault-in latency (cycles, max %u):\n", zram.fault_max_cycles);
+    for (unsigned i = 0; i < ZENOS_ZRAM_LAT_BUCKETS; i++) {
+        if (zram.fault_lat_hist[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            printf("  <512: %u\n", zram.fault_lat_hist[i]);
+        } else if (i == ZENOS_ZRAM_LAT_BUCKETS - 1) {
+            printf("  >=%u: %u\n", 1u << (i + 8), zram.fault_lat_hist[i]);
+        } else {
+            printf("  %u-%u: %u\n", 1u << (i + 8), (1u << (i + 9)) - 1,
+                   zram.fault_lat_hist[i]);
+        }
+    }
+}
+
+static void show_vmstat(void) {
+    zenos_vmstat_t all;
+    zenos_vmstat_t self;
+
+    if (zenos_vmstat(&all, &self) < 0) {
+        puts("vmstat: syscall failed");
+        return;
+    }
+
+    puts("                system / this process");
+    printf("faults:         %u / %u\n", all.faults, self.faults);
+    printf("  minor:        %u / %u\n", all.faults_minor, self.faults_minor);
+    printf("  major:        %u / %u\n", all.faults_major, self.faults_major);
+    printf("  zero-fill:    %u / %u\n", all.faults_zero, self.faults_zero);
+    printf("invlpg:         %u / %u\n", all.invlpg, self.invlpg);
+    printf("tlb flushes:    %u / %u\n", all.tlb_flushes, self.tlb_flushes);
+    printf("pages mapped:   %u / %u\n", all.pages_mapped, self.pages_mapped);
+    printf("pages unmapped: %u / %u\n", all.pages_unmapped, self.pages_unmapped);
+    printf("page tables:    %u / %u\n", all.pt_pages, self.pt_pages);
+}
+
+static void show_kmprof(void) {
+    static zenos_kmprof_site_t sites[KMPROF_MAX_SITES];
+    zenos_kmprof_t prof;
+
+    int n = zenos_kmprof(&prof, sites, KMPROF_MAX_SITES);
+    if (n < 0) {
+        puts("kmprof: kernel built without KPROF=1");
+        return;
+    }
+
+    printf("kernel heap: %u bytes live in %u blocks, peak %u bytes\n",
+           prof.live_bytes, prof.live_count, prof.peak_bytes);
+    printf("%u allocs, %u frees, %u failed, %u callsites\n",
+           prof.allocs, prof.frees, prof.fails, prof.nr_sites);
+
+    puts("live bytes / blocks / peak / allocs / frees  callsite");
+    for (int i = 0; i < n; i++) {
+        const zenos_kmprof_site_t *s = &sites[i];
+        printf("  %u / %u / %u / %u / %u  ",
+               s->live_bytes, s->live_count, s->peak_bytes, s->allocs, s->frees);
+        if (s->sym[0]) {
+            printf("%s+0x%x (0x%x)\n", s->sym, s->sym_off, s->caller);
+        } else {
+            printf("0x%x\n", s->caller);
+        }
+    }
+
+    puts("kmalloc latency (cycles):");
+    for (unsigned i = 0; i < ZENOS_KMPROF_LAT_BUCKETS; i++) {
+        if (prof.lat_hist[i] == 0) {
+            continue;
+        }
+        if (i == 0) {
+            printf("  <64: %u\n", prof.lat_hist[i]);
+        } else if (i == ZENOS_KMPROF_LAT_BUCKETS - 1) {
+            printf("  >=%u: %u\n", 1u << (i + 5), prof.lat_hist[i]);
+        } else {
+            printf("  %u-%u: %u\n", 1u << (i + 5), (1u << (i + 6)) - 1,
+                   prof.lat_hist[i]);
+        }
+    }
+}
+
 static void run_command(const char *line) {
     if (line[0] == '\0') {
         return;
     }
 
     if (strcmp(line, "help") == 0) {
-        puts("commands: help, echo, about, clear, hello");
+        puts("commands: help, echo, about, clear, hello, meminfo, swapinfo, vmstat, kmprof");
         return;
     }
 
@@ -36,9 +179,37 @@ static void run_command(const char *line) {
         return;
     }
 
+    if (strcmp(line, "meminfo") == 0) {
+        show_meminfo();
+        return;
+    }
+
+    if (strcmp(line, "swapinfo") == 0) {
+        show_swapinfo();
+        return;
+    }
+
+    if (strcmp(line, "vmstat") == 0) {
+        show_vmstat();
+        return;
+    }
+
+    if (strcmp(line, "kmprof") == 0) {
+        show_kmprof();
+        return;
+    }
+
     if (strcmp(line, "hello") == 0) {
-        exec("/hello");
-        printf("exec failed: /hello\n");
+        int pid = fork();
+        if (pid < 0) {
+            puts("fork failed");
+            return;
+        }
+        if (pid == 0) {
+            exec("/hello");
+            printf("exec failed: /hello\n");
+            exit(1);
+        }
         return;
     }
 
@@ -0,0 +1,7 @@
+#include <fcntl.h>
+#include <zenos/syscall.h>
+
+int open(const char *path, int flags) {
+    (void)flags; /* ext2 is read-only for now */
+    return zenos_syscall1(SYS_OPEN, (int)path);
+}
@@ -0,0 +1,16 @@
+#ifndef _USERLIBC_FCNTL_H
+#define _USERLIBC_FCNTL_H 1
+
+#define O_RDONLY 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int open(const char *path, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
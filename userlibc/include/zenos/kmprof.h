@@ -0,0 +1,45 @@
+#ifndef _ZENOS_KMPROF_H
+#define _ZENOS_KMPROF_H 1
+
+/* Must match kmalloc_site_t / kmalloc_prof_t in the kernel's kmalloc.h. */
+#define ZENOS_KMPROF_LAT_BUCKETS 12
+#define ZENOS_KMPROF_SYM_LEN     32
+
+typedef struct {
+    unsigned int caller;
+    unsigned int sym_off;
+    char         sym[ZENOS_KMPROF_SYM_LEN];
+    unsigned int live_bytes;
+    unsigned int live_count;
+    unsigned int peak_bytes;
+    unsigned int allocs;
+    unsigned int frees;
+} zenos_kmprof_site_t;
+
+typedef struct {
+    unsigned int live_bytes;
+    unsigned int live_count;
+    unsigned int peak_bytes;
+    unsigned int allocs;
+    unsigned int frees;
+    unsigned int fails;
+    unsigned int nr_sites;
+    unsigned int lat_hist[ZENOS_KMPROF_LAT_BUCKETS];
+} zenos_kmprof_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Kernel heap profile: summary plus up to max callsites, biggest live bytes
+ * first. Returns the number of callsites, or -1 if the kernel was built
+ * without KPROF=1.
+ */
+int zenos_kmprof(zenos_kmprof_t *summary, zenos_kmprof_site_t *sites, unsigned int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
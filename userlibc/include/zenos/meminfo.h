@@ -0,0 +1,41 @@
+#ifndef _ZENOS_MEMINFO_H
+#define _ZENOS_MEMINFO_H 1
+
+/* Must match pmm_stats_t in the kernel's pmm.h. */
+#define ZENOS_LAT_BUCKETS 12
+
+typedef struct {
+    unsigned int total_frames;
+    unsigned int free_frames;
+    unsigned int used_frames;
+    unsigned int largest_free_run;
+    unsigned int frag_score;
+    unsigned int alloc_count;
+    unsigned int free_count;
+    unsigned int zero_pooled;
+    unsigned int zero_hits;
+    unsigned int zero_misses;
+    unsigned int alloc_lat_hist[ZENOS_LAT_BUCKETS];
+} zenos_meminfo_t;
+
+/* Must match vmm_huge_stats_t in the kernel's vmm.h. */
+typedef struct {
+    unsigned int mapped;
+    unsigned int faults;
+    unsigned int fallbacks;
+    unsigned int splits;
+    unsigned int frees;
+} zenos_hugeinfo_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int zenos_meminfo(zenos_meminfo_t *info);
+int zenos_hugeinfo(zenos_hugeinfo_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _ZENOS_SWAPINFO_H
+#define _ZENOS_SWAPINFO_H 1
+
+/* Must match swap_stats_t in the kernel's swap.h. */
+typedef struct {
+    unsigned int total_slots;
+    unsigned int used_slots;
+    unsigned int swap_outs;
+    unsigned int swap_ins;
+    unsigned int scanned;
+    unsigned int referenced;
+    unsigned int alloc_fail;
+    unsigned int io_errors;
+} zenos_swap_stats_t;
+
+/* Must match zram_stats_t in the kernel's zram.h. */
+#define ZENOS_ZRAM_LAT_BUCKETS 12
+
+typedef struct {
+    unsigned int stored_pages;
+    unsigned int same_pages;
+    unsigned int compr_bytes;
+    unsigned int pool_bytes;
+    unsigned int ratio_x100;
+    unsigned int stores;
+    unsigned int loads;
+    unsigned int rejected;
+    unsigned int pool_full;
+    unsigned int fault_max_cycles;
+    unsigned int fault_lat_hist[ZENOS_ZRAM_LAT_BUCKETS];
+} zenos_zram_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int zenos_swapinfo(zenos_swap_stats_t *swap, zenos_zram_stats_t *zram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -9,6 +9,17 @@ enum {
     SYS_CLEAR   = 4,
     SYS_EXIT    = 5,
     SYS_EXEC    = 6,
+    SYS_MEMINFO = 7,
+    SYS_FORK    = 8,
+    SYS_MMAP    = 9,
+    SYS_MUNMAP  = 10,
+    SYS_MPROTECT = 11,
+    SYS_OPEN    = 12,
+    SYS_CLOSE   = 13,
+    SYS_SWAPINFO = 14,
+    SYS_HUGEINFO = 15,
+    SYS_VMSTAT  = 16,
+    SYS_KMPROF  = 17,
 };
 
 #ifdef __cplusplus
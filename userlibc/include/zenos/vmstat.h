@@ -0,0 +1,28 @@
+#ifndef _ZENOS_VMSTAT_H
+#define _ZENOS_VMSTAT_H 1
+
+/* Must match vmstat_t in the kernel's vmm.h. */
+typedef struct {
+    unsigned int faults;
+    unsigned int faults_minor;
+    unsigned int faults_major;
+    unsigned int faults_zero;
+    unsigned int invlpg;
+    unsigned int tlb_flushes;
+    unsigned int pages_mapped;
+    unsigned int pages_unmapped;
+    unsigned int pt_pages;
+} zenos_vmstat_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* global: whole system; proc: the calling process's address space. */
+int zenos_vmstat(zenos_vmstat_t *global, zenos_vmstat_t *proc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+#include <sys/mman.h>
+#include <zenos/syscall.h>
+
+/* Same layout as the kernel's mmap_args_t: too many arguments for registers. */
+struct mmap_args {
+    unsigned int addr;
+    unsigned int len;
+    unsigned int prot;
+    unsigned int flags;
+    int fd;
+    unsigned int offset;
+};
+
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset) {
+    struct mmap_args args = {
+        (unsigned int)addr, length, (unsigned int)prot, (unsigned int)flags,
+        fd, (unsigned int)offset,
+    };
+
+    return (void *)zenos_syscall1(SYS_MMAP, (int)&args);
+}
+
+int munmap(void *addr, size_t length) {
+    return zenos_syscall3(SYS_MUNMAP, (int)addr, (int)length, 0);
+}
+
+int mprotect(void *addr, size_t length, int prot) {
+    return zenos_syscall3(SYS_MPROTECT, (int)addr, (int)length, prot);
+}
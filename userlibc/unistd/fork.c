@@ -0,0 +1,6 @@
+#include <unistd.h>
+#include <zenos/syscall.h>
+
+int fork(void) {
+    return zenos_syscall1(SYS_FORK, 0);
+}
@@ -0,0 +1,6 @@
+#include <zenos/syscall.h>
+#include <zenos/kmprof.h>
+
+int zenos_kmprof(zenos_kmprof_t *summary, zenos_kmprof_site_t *sites, unsigned int max) {
+    return zenos_syscall3(SYS_KMPROF, (int)summary, (int)sites, (int)max);
+}
@@ -0,0 +1,10 @@
+#include <zenos/syscall.h>
+#include <zenos/meminfo.h>
+
+int zenos_meminfo(zenos_meminfo_t *info) {
+    return zenos_syscall1(SYS_MEMINFO, (int)info);
+}
+
+int zenos_hugeinfo(zenos_hugeinfo_t *info) {
+    return zenos_syscall1(SYS_HUGEINFO, (int)info);
+}
@@ -0,0 +1,6 @@
+#include <zenos/syscall.h>
+#include <zenos/swapinfo.h>
+
+int zenos_swapinfo(zenos_swap_stats_t *swap, zenos_zram_stats_t *zram) {
+    return zenos_syscall3(SYS_SWAPINFO, (int)swap, (int)zram, 0);
+}
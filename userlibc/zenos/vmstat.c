@@ -0,0 +1,6 @@
+#include <zenos/syscall.h>
+#include <zenos/vmstat.h>
+
+int zenos_vmstat(zenos_vmstat_t *global, zenos_vmstat_t *proc) {
+    return zenos_syscall3(SYS_VMSTAT, (int)global, (int)proc, 0);
+}